@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+# Mock of a shelly Gen2+ device for benchmarks without real devices
+# Replays recorded responses of the /rpc tree (GET and JSON-RPC POST) and implements the SHA-256 digest
+# authentication challenge as done by shelly devices (nonce expires after --nonce-ttl).
+# ws://<host>/rpc accepts JSON-RPC requests over WebSocket, answers the first request without auth
+# with the 401 error of shelly devices if --password is set, and pushes NotifyStatus (and every
+# 5th time NotifyEvent) frames every --notify seconds after the first successful request.
+#
+#   python3 mockShelly.py --port 80 --password YourShellyPassword --delay 20
+#
+# Then use the IP address of this computer instead of the shelly device, e.g. in
+# examples/network.h. Prints statistics of requests and bytes sent every 10 seconds.
+
+import argparse
+import base64
+import hashlib
+import json
+import random
+import select
+import socket
+import struct
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import urlparse
+
+DEVICE = "shellyplus1pm-mock"
+
+# recorded responses, component part of Shelly.GetStatus is used for <Component>.GetStatus
+STATUS = {
+    "ble": {},
+    "cloud": {"connected": True},
+    "input:0": {"id": 0, "state": False},
+    "mqtt": {"connected": False},
+    "switch:0": {"id": 0, "source": "init", "output": True, "apower": 48.3, "voltage": 231.3,
+                 "current": 0.245, "aenergy": {"total": 1234.567, "by_minute": [805.0, 810.3, 812.1],
+                 "minute_ts": 1700000000}, "temperature": {"tC": 43.2, "tF": 109.7}},
+    "sys": {"mac": "A8032ABCDEF0", "restart_required": False, "time": "12:00", "unixtime": 1700000000,
+            "uptime": 123456, "ram_size": 246680, "ram_free": 143380, "fs_size": 458752, "fs_free": 135168,
+            "cfg_rev": 12, "kvs_rev": 0, "schedule_rev": 0, "webhook_rev": 0,
+            "available_updates": {}},
+    "wifi": {"sta_ip": "192.168.178.210", "status": "got ip", "ssid": "FRITZ!e24", "rssi": -51},
+    "ws": {"connected": False},
+    "em:0": {"id": 0, "a_current": 0.806, "a_voltage": 231.2, "a_act_power": 133.8, "a_aprt_power": 186.4,
+             "a_pf": 0.72, "a_freq": 50.0, "b_current": 0.251, "b_voltage": 230.9, "b_act_power": 23.4,
+             "b_aprt_power": 58.0, "b_pf": 0.4, "b_freq": 50.0, "c_current": 0.0, "c_voltage": 231.6,
+             "c_act_power": 0.0, "c_aprt_power": 0.0, "c_pf": 0.0, "c_freq": 50.0, "n_current": None,
+             "total_current": 1.057, "total_act_power": 157.2, "total_aprt_power": 244.4,
+             "user_calibrated_phase": []},
+    "temperature:0": {"id": 0, "tC": 27.5, "tF": 81.5},
+}
+CONFIG = {"switch:0": {"id": 0, "name": None, "in_mode": "follow", "initial_state": "match_input",
+                       "auto_on": False, "auto_off": False, "power_limit": 4480, "voltage_limit": 280,
+                       "current_limit": 16.0}}
+DEVICE_INFO = {"name": None, "id": DEVICE, "mac": "A8032ABCDEF0", "model": "SNSW-001P16EU", "gen": 2,
+               "fw_id": "20231107-164738/1.0.8-g", "ver": "1.0.8", "app": "Plus1PM", "auth_en": False,
+               "auth_domain": None}
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"  # RFC 6455
+
+stats = {"requests": 0, "challenges": 0, "bytes": 0, "connections": 0, "notifications": 0}
+lock = threading.Lock()
+
+
+def sha256(s):
+    return hashlib.sha256(s.encode()).hexdigest()
+
+
+def rpc(method, params):
+    """return result of rpc method or None if unknown"""
+    component, _, name = method.partition(".")
+    component = component.lower()
+    key = component if component in ("wifi", "sys", "cloud", "mqtt", "ws") else component + ":" + params.get("id", "0")
+    if component == "shelly":
+        return {"getstatus": STATUS, "getconfig": CONFIG, "getdeviceinfo": DEVICE_INFO}.get(name.lower())
+    if name == "GetStatus":
+        return STATUS.get(key)
+    if name == "GetConfig":
+        return CONFIG.get(key, {})
+    if name in ("Set", "Toggle"):
+        if key in STATUS:
+            was_on = STATUS[key].get("output", False)
+            STATUS[key]["output"] = (params.get("on") == "true") if name == "Set" else not was_on
+            return {"was_on": was_on}
+    return None
+
+
+class Handler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"  # keep-alive
+
+    def setup(self):
+        super().setup()
+        # header and body are written separately, do not wait for ACK of header (Nagle)
+        self.connection.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        with lock:
+            stats["connections"] += 1
+
+    def log_message(self, format, *args):
+        pass
+
+    def send(self, code, body, headers=()):
+        data = body.encode()
+        self.send_response(code)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(data)))
+        for header in headers:
+            self.send_header(*header)
+        self.end_headers()
+        self.wfile.write(data)
+        with lock:
+            stats["bytes"] += len(data)
+
+    def authorized(self):
+        """check digest authorization, shelly uses HA2 = SHA256(method ":" uri)"""
+        if not self.server.password:
+            return True
+        auth = self.headers.get("Authorization", "")
+        if not auth.strip().startswith("Digest"):
+            return False
+        fields = {}
+        for part in auth.strip()[6:].split(","):
+            key, _, value = part.strip().partition("=")
+            fields[key] = value.strip('"')
+        nonce = fields.get("nonce", "")
+        if nonce not in self.server.nonces or time.time() - self.server.nonces[nonce] > self.server.nonce_ttl:
+            return False  # unknown or expired nonce
+        ha1 = sha256("admin:" + DEVICE + ":" + self.server.password)
+        ha2 = sha256(self.command + ":" + self.path)
+        expected = sha256(":".join([ha1, nonce, fields.get("nc", ""), fields.get("cnonce", ""),
+                                    fields.get("qop", ""), ha2]))
+        return fields.get("response") == expected
+
+    def challenge(self):
+        """answer with 401 and new nonce"""
+        nonce = self.new_nonce()
+        self.send(401, '{"code":401, "message":"unauthorized"}', [("WWW-Authenticate",
+            'Digest qop="auth", realm="%s", nonce="%s", algorithm=SHA-256' % (DEVICE, nonce))])
+
+    def new_nonce(self):
+        nonce = str(int(time.time())) + str(random.randint(0, 999))
+        now = time.time()
+        for old in [n for n, t in self.server.nonces.items() if now - t > self.server.nonce_ttl]:
+            del self.server.nonces[old]
+        self.server.nonces[nonce] = now
+        with lock:
+            stats["challenges"] += 1
+        return nonce
+
+    # WebSocket, see https://shelly-api-docs.shelly.cloud/gen2/General/RPCChannels#websocket
+
+    def ws_recv(self, n):
+        data = b""
+        while len(data) < n:
+            chunk = self.connection.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError("closed")
+            data += chunk
+        return data
+
+    def ws_frame(self):
+        """receive frame as (opcode, payload), client frames are masked"""
+        b0, b1 = self.ws_recv(2)
+        length = b1 & 0x7F
+        if length == 126:
+            length = struct.unpack(">H", self.ws_recv(2))[0]
+        elif length == 127:
+            length = struct.unpack(">Q", self.ws_recv(8))[0]
+        mask = self.ws_recv(4) if b1 & 0x80 else b"\0\0\0\0"
+        payload = bytes(c ^ mask[i & 3] for i, c in enumerate(self.ws_recv(length)))
+        return b0 & 0x0F, payload
+
+    def ws_send(self, opcode, payload):
+        if isinstance(payload, str):
+            payload = payload.encode()
+        if len(payload) < 126:
+            header = struct.pack(">BB", 0x80 | opcode, len(payload))
+        else:
+            header = struct.pack(">BBH", 0x80 | opcode, 126, len(payload))
+        self.connection.sendall(header + payload)
+        with lock:
+            stats["bytes"] += len(payload)
+
+    def ws_authorized(self, auth, nonce):
+        """check auth object of request, HA2 = SHA256("dummy_method:dummy_uri") for RPC channels"""
+        if not self.server.password:
+            return True
+        if not auth or nonce is None or str(auth.get("nonce")) != nonce:
+            return False
+        ha1 = sha256("admin:" + DEVICE + ":" + self.server.password)
+        ha2 = sha256("dummy_method:dummy_uri")
+        expected = sha256(":".join([ha1, nonce, "1", str(auth.get("cnonce", "")), "auth", ha2]))
+        return auth.get("response") == expected
+
+    def websocket(self):
+        key = self.headers.get("Sec-WebSocket-Key", "")
+        accept = base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+        self.send_response(101)
+        self.send_header("Upgrade", "websocket")
+        self.send_header("Connection", "Upgrade")
+        self.send_header("Sec-WebSocket-Accept", accept)
+        self.end_headers()
+        self.close_connection = True
+        nonce = None
+        dst = None  # src of client, notifications are sent after first successful request
+        count = 0
+        next_notify = 0
+        try:
+            while True:
+                timeout = max(0, next_notify - time.time()) if dst else None
+                if not select.select([self.connection], [], [], timeout)[0]:
+                    count += 1
+                    switch = STATUS["switch:0"]
+                    switch["apower"] = round(switch["apower"] + random.uniform(-5, 5), 1)
+                    if count % 5 == 0:
+                        frame = {"src": DEVICE, "dst": dst, "method": "NotifyEvent", "params": {"ts": time.time(),
+                                 "events": [{"component": "input:0", "id": 0, "event": "single_push",
+                                             "ts": time.time()}]}}
+                    else:
+                        frame = {"src": DEVICE, "dst": dst, "method": "NotifyStatus", "params": {"ts": time.time(),
+                                 "switch:0": {"id": 0, "apower": switch["apower"]}}}
+                    self.ws_send(0x1, json.dumps(frame, separators=(",", ":")))
+                    with lock:
+                        stats["notifications"] += 1
+                    next_notify = time.time() + self.server.notify
+                    continue
+                opcode, payload = self.ws_frame()
+                if opcode == 0x8:  # close
+                    self.ws_send(0x8, payload[:2])
+                    return
+                if opcode == 0x9:  # ping
+                    self.ws_send(0xA, payload)
+                    continue
+                if opcode != 0x1:
+                    continue
+                time.sleep(self.server.delay)
+                with lock:
+                    stats["requests"] += 1
+                try:
+                    request = json.loads(payload)
+                except ValueError:
+                    continue
+                response = {"id": request.get("id"), "src": DEVICE, "dst": request.get("src")}
+                if not self.ws_authorized(request.get("auth"), nonce):
+                    nonce = self.new_nonce()
+                    challenge = {"auth_type": "digest", "nonce": int(nonce), "nc": 1, "realm": DEVICE,
+                                 "algorithm": "SHA-256"}
+                    response["error"] = {"code": 401, "message": json.dumps(challenge)}
+                else:
+                    params = {k: str(v).lower() if isinstance(v, bool) else str(v)
+                              for k, v in request.get("params", {}).items()}
+                    result = rpc(request.get("method", ""), params)
+                    if result is None:
+                        response["error"] = {"code": 404, "message": "No handler for %s" % request.get("method")}
+                    else:
+                        response["result"] = result
+                        if dst is None:
+                            dst = request.get("src")
+                            next_notify = time.time() + self.server.notify
+                self.ws_send(0x1, json.dumps(response, separators=(",", ":")))
+        except (ConnectionError, OSError, ValueError):
+            pass
+
+    def do_GET(self):
+        if self.path == "/rpc" and self.headers.get("Upgrade", "").lower() == "websocket":
+            self.websocket()
+            return
+        time.sleep(self.server.delay)
+        with lock:
+            stats["requests"] += 1
+        url = urlparse(self.path)
+        if not url.path.startswith("/rpc/"):
+            self.send(404, "{}")
+            return
+        if not self.authorized():
+            self.challenge()
+            return
+        params = dict(p.partition("=")[::2] for p in url.query.split("&") if p)
+        result = rpc(url.path[5:], params)
+        if result is None:
+            self.send(404, '{"code":404, "message":"No handler for %s"}' % url.path[5:])
+        else:
+            self.send(200, json.dumps(result, separators=(",", ":")))
+
+    def do_POST(self):
+        """JSON-RPC 2.0 request to /rpc, e.g. {"id":1,"method":"Switch.GetStatus","params":{"id":0}}"""
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        time.sleep(self.server.delay)
+        with lock:
+            stats["requests"] += 1
+        if self.path != "/rpc":
+            self.send(404, "{}")
+            return
+        if not self.authorized():
+            self.challenge()
+            return
+        try:
+            request = json.loads(body)
+        except ValueError:
+            self.send(400, '{"code":400, "message":"invalid JSON"}')
+            return
+        params = {k: str(v).lower() if isinstance(v, bool) else str(v) for k, v in request.get("params", {}).items()}
+        result = rpc(request.get("method", ""), params)
+        response = {"id": request.get("id"), "src": DEVICE}
+        if result is None:
+            response["error"] = {"code": 404, "message": "No handler for %s" % request.get("method")}
+        else:
+            response["result"] = result
+        self.send(200, json.dumps(response, separators=(",", ":")))
+
+
+def report():
+    while True:
+        time.sleep(10)
+        with lock:
+            print("requests %(requests)d, challenges %(challenges)d, connections %(connections)d, "
+                  "bytes sent %(bytes)d, notifications %(notifications)d" % stats, flush=True)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="mock of a shelly Gen2+ device")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--password", default="", help="enable digest authentication")
+    parser.add_argument("--delay", type=float, default=0, help="response delay [ms]")
+    parser.add_argument("--nonce-ttl", type=float, default=60, help="nonce expires after [s]")
+    parser.add_argument("--notify", type=float, default=1, help="WebSocket notification interval [s]")
+    args = parser.parse_args()
+    server = ThreadingHTTPServer(("", args.port), Handler)
+    server.password = args.password
+    server.delay = args.delay / 1000
+    server.nonce_ttl = args.nonce_ttl
+    server.nonces = {}
+    server.notify = args.notify
+    threading.Thread(target=report, daemon=True).start()
+    print("mock %s listening on port %d" % (DEVICE, args.port), flush=True)
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
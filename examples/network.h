@@ -12,5 +12,9 @@
 #define BLINDIP    "10.0.0.3"
 #define GRIDIP     "10.0.0.4"
 #define ShellyPASS "YourShellyPassword"
+// device used by shellyBenchmark, could be a computer running mockShelly.py
+#ifndef BENCHIP
+#define BENCHIP    "10.0.0.5"
+#endif
 
 #endif
@@ -0,0 +1,265 @@
+#include <Arduino.h>
+#include <algorithm>
+#if __has_include(<ArduinoJson.h>)
+// JSON library imported from https://arduinojson.org, used for comparison only
+#include <ArduinoJson.h>
+#define BENCH_ARDUINOJSON
+#endif
+#include "network.h" // IP addresses and passwords
+#include "shellyDevice.h"
+
+// benchmark of the different ways to read data from a shelly device
+// Run against a real device or a computer running examples/mockShelly.py
+// (e.g. "python3 mockShelly.py --password YourShellyPassword --delay 20").
+// For each access path requests/s, median and 99th percentile of latency,
+// bytes of payload per request and heap allocations per request are printed.
+// Heap allocations are counted if built with
+//   build_flags = -DSHELLY_BENCH_ALLOC -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
+// otherwise only the change of free heap is shown.
+// Digest calculation (Authorization header) and parsing of recorded responses
+// are compared without network access.
+// Runs on a Linux host as well, see CMakeLists.txt: there is no free heap to show,
+// all allocations of the (single threaded) program are counted.
+
+#define SAMPLES 100   // requests per access path
+#define PARSES  1000  // repetitions of parsing recorded response
+
+ShellyPlus1PM shelly(BENCHIP, ShellyPASS);
+
+unsigned long samples[SAMPLES]; // latency of single requests [us]
+float power, tC;                // results of requests and parsing, kept to be used
+
+// recorded response of Switch.GetStatus?id=0
+const char* switchStatus =
+    "{\"id\":0,\"source\":\"init\",\"output\":true,\"apower\":48.3,\"voltage\":231.3,"
+    "\"current\":0.245,\"aenergy\":{\"total\":1234.567,\"by_minute\":[805.0,810.3,812.1],"
+    "\"minute_ts\":1700000000},\"temperature\":{\"tC\":43.2,\"tF\":109.7}}";
+
+#ifdef SHELLY_BENCH_ALLOC
+volatile bool counting = false;
+volatile unsigned long allocations = 0;
+#ifdef ESP32
+// count allocations of the loop task only, other tasks (WiFi, lwIP) allocate as well
+TaskHandle_t benchTask = NULL;
+static inline bool benchThread() { return xTaskGetCurrentTaskHandle() == benchTask; }
+static inline void startThread() { benchTask = xTaskGetCurrentTaskHandle(); }
+#else
+static inline bool benchThread() { return true; }
+static inline void startThread() {}
+#endif
+extern "C" void* __real_malloc(size_t size);
+extern "C" void* __real_calloc(size_t n, size_t size);
+extern "C" void* __real_realloc(void* ptr, size_t size);
+static inline void countAllocation()
+{
+    if (counting && benchThread())
+        allocations++;
+}
+extern "C" void* __wrap_malloc(size_t size) { countAllocation(); return __real_malloc(size); }
+extern "C" void* __wrap_calloc(size_t n, size_t size) { countAllocation(); return __real_calloc(n, size); }
+extern "C" void* __wrap_realloc(void* ptr, size_t size) { countAllocation(); return __real_realloc(ptr, size); }
+// operator new of the C++ library calls malloc internally, which is not wrapped
+void* operator new(size_t size) { void* p = malloc(size ? size : 1); if (p == NULL) abort(); return p; }
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+static void startCounting() { allocations = 0; startThread(); counting = true; }
+static unsigned long stopCounting() { counting = false; return allocations; }
+#else
+static void startCounting() {}
+static unsigned long stopCounting() { return 0; }
+#endif
+
+#ifdef ARDUINO
+static int freeHeap() { return ESP.getFreeHeap(); }
+#else
+static int freeHeap() { return 0; } // not available on host
+#endif
+
+// print results of a series of measurements
+void report(const char* name, int count, unsigned long total, size_t bytes, unsigned long allocs, int heap)
+{
+    std::sort(samples, samples+count);
+    Serial.printf("%-22s %8.1f /s  p50 %7lu us  p99 %7lu us  %5u bytes  %6.1f allocs  heap %+6d\n",
+        name,
+        1e6 * count / total,
+        samples[count/2],
+        samples[(count*99)/100],
+        (unsigned)(bytes / count),
+        (float)allocs / count,
+        heap);
+}
+
+// run request SAMPLES times, request returns number of payload bytes
+template <typename F> void bench(const char* name, F request)
+{
+    size_t bytes = 0;
+    request(); // warm up, connect and authenticate
+    int heap = freeHeap();
+    startCounting();
+    unsigned long start = micros();
+    for (int i=0; i<SAMPLES; i++)
+    {
+        unsigned long t = micros();
+        bytes += request();
+        samples[i] = micros() - t;
+    }
+    unsigned long total = micros() - start;
+    unsigned long allocs = stopCounting();
+    report(name, SAMPLES, total, bytes, allocs, freeHeap() - heap);
+}
+
+// same for parsing recorded response, only every 10th time is sampled
+template <typename F> void benchParse(const char* name, F parse)
+{
+    size_t bytes = 0;
+    int heap = freeHeap();
+    startCounting();
+    unsigned long start = micros();
+    for (int i=0; i<PARSES; i++)
+    {
+        unsigned long t = micros();
+        bytes += parse();
+        if (i % 10 == 0)
+            samples[i/10] = micros() - t;
+    }
+    unsigned long total = micros() - start;
+    unsigned long allocs = stopCounting();
+    report(name, PARSES/10, total/10, bytes/10, allocs/10, freeHeap() - heap);
+}
+
+void connectWiFi()
+{
+#ifdef ARDUINO
+  Serial.print("connecting to WiFi ");
+  WiFi.begin(WIFI_SSID, WIFI_PASS);
+  while (WiFi.status() != WL_CONNECTED) {
+      delay(500);
+      Serial.print(".");
+  }
+  Serial.print("\rIP Address ");
+  Serial.println(WiFi.localIP());
+#else
+  Serial.println("using network of host");
+#endif
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    Serial.println();
+    Serial.println("=============================");
+    Serial.println("ESP SHELLY benchmark starting");
+    Serial.println();
+    connectWiFi();
+    shelly.name = "benchmark device";
+}
+
+void benchRequests()
+{
+    Serial.printf("--- requests to %s, %d samples each\n", shelly.server().c_str(), SAMPLES);
+    bench("GET String", []() {
+        return shelly.GET("Switch.GetStatus?id=0").length();
+    });
+    static char buffer[512];
+    bench("GET buffer", []() {
+        shelly.GET("Switch.GetStatus?id=0", buffer, sizeof(buffer));
+        return strlen(buffer);
+    });
+    bench("GET extractParam", []() {
+        String response = shelly.GET("Switch.GetStatus?id=0");
+        power = shelly.extractParam(response, "\"apower\":", ',').toFloat();
+        return response.length();
+    });
+    bench("SwitchRefresh", []() {
+        shelly.SwitchRefresh();
+        return (size_t)0;
+    });
+    shelly.setStatusTTL(0); // every call reads status
+    bench("ActivePower TTL 0", []() {
+        power = shelly.ActivePower();
+        return (size_t)0;
+    });
+    shelly.setStatusTTL(1000);
+    bench("refresh (all)", []() {
+        shelly.refresh();
+        return (size_t)0;
+    });
+    shelly.setKeepAlive(0); // new connection for each request
+    bench("GET String, no reuse", []() {
+        return shelly.GET("Switch.GetStatus?id=0").length();
+    });
+    shelly.setKeepAlive(5000);
+    Serial.printf("authentication challenges %lu, requests using cached nonce %lu\n",
+        shelly.authChallenges(), shelly.authAvoided());
+}
+
+// access to digest calculation of shellyDevice
+class shellyBenchmark
+{
+public:
+    // Authorization header from cached challenge, two SHA-256 hashes (HA2 and response)
+    static size_t authorization(shellyDevice &device, char* buffer, size_t size)
+    {
+        return strlen(device.authorization("/rpc/Switch.GetStatus?id=0", buffer, size));
+    }
+};
+
+void benchDigest()
+{
+    Serial.printf("--- digest authentication, %d times each\n", PARSES);
+    if (shelly.authChallenges() == 0)
+    {
+        Serial.println("device does not require authentication");
+        return;
+    }
+    static char header[256];
+    benchParse("Authorization header", []() {
+        return shellyBenchmark::authorization(shelly, header, sizeof(header));
+    });
+    Serial.println("each header is 2 SHA-256 hashes, requests above include one each");
+}
+
+void benchParsing()
+{
+    Serial.printf("--- parsing recorded response, %d times each\n", PARSES);
+    benchParse("extractParam", []() {
+        String response = switchStatus;
+        power = shelly.extractParam(response, "\"apower\":", ',').toFloat();
+        tC = shelly.extractParam(response, "\"tC\":", ',').toFloat();
+        return response.length();
+    });
+    static shellyJsonScanner scanner([](const char* path, const char* value) {
+        if (strcmp(path, "apower") == 0)
+            power = atof(value);
+        else if (strcmp(path, "temperature.tC") == 0)
+            tC = atof(value);
+    });
+    benchParse("shellyJsonScanner", []() {
+        scanner.reset();
+        scanner.scan(switchStatus);
+        return strlen(switchStatus);
+    });
+#ifdef BENCH_ARDUINOJSON
+    benchParse("ArduinoJson", []() {
+        JsonDocument doc;
+        deserializeJson(doc, switchStatus);
+        power = doc["apower"];
+        tC = doc["temperature"]["tC"];
+        return strlen(switchStatus);
+    });
+#endif
+}
+
+void loop()
+{
+    benchRequests();
+    benchDigest();
+    benchParsing();
+#ifdef ARDUINO
+    Serial.printf("free heap %u, largest block %u\n\n", ESP.getFreeHeap(), ESP.getMaxAllocHeap());
+    delay(10000);
+#endif
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+# Reader of binary logs written by shellyLog (see src/shellyLog.h for the format)
+# Copy the log file and its .idx from the ESP32 (e.g. LittleFS) to this computer, then
+#
+#   python3 shellyLog.py power.log                          # all records as CSV
+#   python3 shellyLog.py power.log --from 1700000000 --to 1700086400 --step 900
+#
+# The index file is optional, it is used to skip blocks before --from if found.
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+MAGIC = b"SHLG"
+NAME_LEN = 16
+NAN = -2**31  # INT32_MIN marks values not available
+
+
+def varint(data, pos):
+    value = 0
+    shift = 0
+    while pos < len(data):
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            return value, pos
+        shift += 7
+    return None, pos  # truncated
+
+
+def unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+class ShellyLog:
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        magic, version, channels, self.block = struct.unpack_from("<4sBBH", self.data, 0)
+        if magic != MAGIC or version != 1:
+            raise ValueError("not a shellyLog file or unsupported version")
+        self.names = []
+        self.scales = []
+        for i in range(channels):
+            name, scale = struct.unpack_from("<%dsf" % NAME_LEN, self.data, 8 + i * (NAME_LEN + 4))
+            self.names.append(name.split(b"\0")[0].decode())
+            self.scales.append(scale)
+        self.blocks = (len(self.data) - self.block + self.block - 1) // self.block
+        self.index = None
+        if os.path.exists(path + ".idx"):
+            with open(path + ".idx", "rb") as f:
+                index = f.read()
+            self.index = list(struct.unpack("<%dI" % (len(index) // 4), index[:len(index) // 4 * 4]))
+
+    def block_ts(self, b):
+        if self.index is not None and b < len(self.index):
+            return self.index[b]
+        return struct.unpack_from("<I", self.data, (b + 1) * self.block)[0]
+
+    def decode(self, b):
+        """records of block b as (ts, [values])"""
+        start = (b + 1) * self.block
+        block = self.data[start:start + self.block]
+        n = len(self.names)
+        if len(block) < 4 + 4 * n:
+            return
+        ts = struct.unpack_from("<I", block, 0)[0]
+        values = list(struct.unpack_from("<%di" % n, block, 4))
+        yield ts, values
+        pos = 4 + 4 * n
+        while pos < len(block) and block[pos] != 0:
+            dt, pos = varint(block, pos)
+            deltas = []
+            for _ in range(n):
+                delta, pos = varint(block, pos)
+                deltas.append(delta)
+            if dt is None or None in deltas:
+                return  # truncated record
+            ts += dt - 1
+            values = [v + unzigzag(d) for v, d in zip(values, deltas)]
+            yield ts, list(values)
+
+    def records(self, ts=0, end_ts=None):
+        """records from ts to end_ts as (ts, [float or nan])"""
+        first = 0
+        for b in range(self.blocks):  # index is small, linear search is fine on a host
+            if self.block_ts(b) <= ts:
+                first = b
+        for b in range(first, self.blocks):
+            for rts, values in self.decode(b):
+                if rts < ts:
+                    continue
+                if end_ts is not None and rts > end_ts:
+                    return
+                yield rts, [math.nan if v == NAN else v / s for v, s in zip(values, self.scales)]
+
+    def averages(self, ts, end_ts, step):
+        """mean values over step seconds as (start of interval, [float or nan])"""
+        interval = None
+        sums = counts = None
+        for rts, values in self.records(ts, end_ts):
+            start = rts - rts % step
+            if start != interval:
+                if interval is not None:
+                    yield interval, [s / c if c else math.nan for s, c in zip(sums, counts)]
+                interval = start
+                sums = [0.0] * len(values)
+                counts = [0] * len(values)
+            for i, v in enumerate(values):
+                if not math.isnan(v):
+                    sums[i] += v
+                    counts[i] += 1
+        if interval is not None:
+            yield interval, [s / c if c else math.nan for s, c in zip(sums, counts)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="export shellyLog file as CSV")
+    parser.add_argument("file")
+    parser.add_argument("--from", dest="ts", type=int, default=0, help="unix time of first record")
+    parser.add_argument("--to", dest="end_ts", type=int, default=None, help="unix time of last record")
+    parser.add_argument("--step", type=int, default=0, help="average over step seconds")
+    args = parser.parse_args()
+
+    log = ShellyLog(args.file)
+    rows = log.averages(args.ts, args.end_ts, args.step) if args.step > 0 else log.records(args.ts, args.end_ts)
+    out = sys.stdout
+    out.write(",".join(["ts"] + log.names) + "\n")
+    for ts, values in rows:
+        out.write(",".join([str(ts)] + ["" if math.isnan(v) else "%g" % v for v in values]) + "\n")
+
+
+if __name__ == "__main__":
+    main()
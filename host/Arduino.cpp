@@ -0,0 +1,136 @@
+#include "Arduino.h"
+#include <stdarg.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+
+// time since start of program
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+static std::minstd_rand generator(std::random_device{}());
+static std::mutex generatorMutex; // used by worker threads of shellyPoller as well
+
+long random(long max)
+{
+    std::lock_guard<std::mutex> lock(generatorMutex);
+    return (max > 0) ? (long)(generator() % (unsigned long)max) : 0;
+}
+
+long random(long min, long max)
+{
+    return (max > min) ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed)
+{
+    std::lock_guard<std::mutex> lock(generatorMutex);
+    generator.seed(seed);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+    while ((n < size) && write(buffer[n]))
+        n++;
+    return n;
+}
+
+size_t Print::printf(const char* format, ...)
+{
+    char text[128];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0)
+        return 0;
+    if (len < (int)sizeof(text))
+        return write((const uint8_t*)text, len);
+    char* buffer = (char*)malloc(len + 1); // long text
+    if (buffer == nullptr)
+        return 0;
+    va_start(args, format);
+    vsnprintf(buffer, len + 1, format, args);
+    va_end(args);
+    len = write((const uint8_t*)buffer, len);
+    free(buffer);
+    return len;
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+            return c;
+        delay(1);
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+    size_t n = 0;
+    while (n < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+            break;
+        buffer[n++] = (char)c;
+    }
+    return n;
+}
+
+String Stream::readString()
+{
+    String text;
+    int c;
+    while ((c = timedRead()) >= 0)
+        text += (char)c;
+    return text;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+    return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
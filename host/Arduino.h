@@ -0,0 +1,52 @@
+#ifndef _ARDUINO_H_
+#define _ARDUINO_H_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include "WString.h"
+#include "Print.h"
+
+// minimal Arduino core to build and run the library on a Linux host
+// Provides what the library and examples/shellyBenchmark.cpp use: String, Print,
+// Stream, Serial (stdout), time and random functions. Network access is provided
+// by shellyHostTransport.h, files by FS.h and SHA-256 by Crypto.h of this directory.
+// NOTE: not compiled by Arduino or PlatformIO builds of the library (src/ only)
+
+typedef uint8_t byte;
+using std::min;
+using std::max;
+
+#define F(text) (text)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Serial monitor is stdout
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long /*baud*/) {};
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override { return 0; };
+    int read() override { return -1; };
+    int peek() override { return -1; };
+    void flush() override;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef _CRYPTO_H_
+#define _CRYPTO_H_
+#include <stddef.h>
+#include <stdint.h>
+
+// SHA256 of the Crypto library (intrbiz/Crypto) for host builds
+// Same interface as used by the library on ESP32, implemented in plain C++ (FIPS 180-4).
+
+#define SHA256_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+class SHA256
+{
+public:
+    SHA256() { reset(); };
+    void reset();
+    void doUpdate(const uint8_t* msg, size_t len);
+    void doUpdate(const char* msg, size_t len) { doUpdate((const uint8_t*)msg, len); };
+    void doUpdate(const char* msg);
+    void doFinal(uint8_t* digest); // SHA256_SIZE bytes
+private:
+    uint32_t _state[8];
+    uint8_t _buffer[SHA256_BLOCK_SIZE];
+    size_t _bufferLen;
+    uint64_t _totalLen;             // bytes
+    void transform(const uint8_t* block);
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "FS.h"
+#include <sys/stat.h>
+
+using namespace fs;
+
+size_t File::write(const uint8_t* buffer, size_t size)
+{
+    return _file ? fwrite(buffer, 1, size, _file.get()) : 0;
+}
+
+int File::available()
+{
+    return _file ? (int)(size() - position()) : 0;
+}
+
+int File::read()
+{
+    return _file ? fgetc(_file.get()) : -1;
+}
+
+int File::peek()
+{
+    int c = read();
+    if (c >= 0)
+        ungetc(c, _file.get());
+    return c;
+}
+
+void File::flush()
+{
+    if (_file)
+        fflush(_file.get());
+}
+
+size_t File::read(uint8_t* buffer, size_t size)
+{
+    return _file ? fread(buffer, 1, size, _file.get()) : 0;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode)
+{
+    static const int whence[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+    return _file && (fseek(_file.get(), pos, whence[mode]) == 0);
+}
+
+size_t File::position() const
+{
+    return _file ? ftell(_file.get()) : 0;
+}
+
+size_t File::size() const
+{
+    struct stat st;
+    if (!_file)
+        return 0;
+    fflush(_file.get());
+    return (fstat(fileno(_file.get()), &st) == 0) ? st.st_size : 0;
+}
+
+// "r", "w" and "a" open binary files like LittleFS does
+File FS::open(const char* path, const char* mode)
+{
+    char hostMode[4] = "rb";
+    hostMode[0] = mode[0];
+    FILE* file = fopen(hostPath(path).c_str(), hostMode);
+    return (file != nullptr) ? File(file) : File();
+}
+
+bool FS::exists(const char* path)
+{
+    struct stat st;
+    return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path)
+{
+    return ::remove(hostPath(path).c_str()) == 0;
+}
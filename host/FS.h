@@ -0,0 +1,63 @@
+#ifndef _FS_H_
+#define _FS_H_
+#include <stdio.h>
+#include <memory>
+#include "Arduino.h"
+
+// file system of the ESP32 core (e.g. LittleFS) for host builds
+// Files are stored below a directory of the host, paths like "/power.log" are relative to it.
+//   fs::FS flash("/tmp/flash");
+//   shellyLog history(flash, "/power.log");
+
+namespace fs
+{
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class File : public Stream
+{
+public:
+    File() {};
+    File(FILE* file) : _file(file, fclose) {};
+    size_t write(uint8_t c) override { return write(&c, 1); };
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t* buffer, size_t size);
+    bool seek(uint32_t pos, SeekMode mode=SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close() { _file.reset(); };
+    operator bool() const { return _file != nullptr; };
+private:
+    std::shared_ptr<FILE> _file;    // copies refer to same file like on ESP32
+};
+
+class FS
+{
+public:
+    FS(const char* root=".") : _root(root) {};
+    File open(const char* path, const char* mode="r"); // mode "r", "w" or "a"
+    File open(const String &path, const char* mode="r") { return open(path.c_str(), mode); };
+    bool exists(const char* path);
+    bool exists(const String &path) { return exists(path.c_str()); };
+    bool remove(const char* path);
+    bool remove(const String &path) { return remove(path.c_str()); };
+private:
+    String _root;
+    String hostPath(const char* path) { return _root + path; };
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif
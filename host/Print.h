@@ -0,0 +1,54 @@
+#ifndef _PRINT_H_
+#define _PRINT_H_
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "WString.h"
+
+// Print and Stream of the Arduino core for host builds
+
+class Print
+{
+public:
+    virtual ~Print() {};
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return (str != nullptr) ? write((const uint8_t*)str, strlen(str)) : 0; };
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); };
+    virtual void flush() {};
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t print(const String &s) { return write(s.c_str(), s.length()); };
+    size_t print(const char* str) { return write(str); };
+    size_t print(char c) { return write((uint8_t)c); };
+    size_t print(unsigned char value, int base=DEC) { return print(String(value, base)); };
+    size_t print(int value, int base=DEC) { return print(String(value, base)); };
+    size_t print(unsigned int value, int base=DEC) { return print(String(value, base)); };
+    size_t print(long value, int base=DEC) { return print(String(value, base)); };
+    size_t print(unsigned long value, int base=DEC) { return print(String(value, base)); };
+    size_t print(long long value, int base=DEC) { return print(String(value, base)); };
+    size_t print(unsigned long long value, int base=DEC) { return print(String(value, base)); };
+    size_t print(double value, int digits=2) { return print(String(value, digits)); };
+
+    size_t println() { return write("\r\n"); };
+    template <typename T> size_t println(const T &value) { return print(value) + println(); };
+    template <typename T> size_t println(const T &value, int format) { return print(value, format) + println(); };
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }; // [ms]
+    unsigned long getTimeout() { return _timeout; };
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); };
+    String readString();
+protected:
+    unsigned long _timeout = 1000;
+    int timedRead(); // -1 on timeout
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+String::String(const char* cstr)
+{
+    if (cstr != nullptr)
+        copy(cstr, strlen(cstr));
+}
+
+String::String(const char* cstr, unsigned int length)
+{
+    if (cstr != nullptr)
+        copy(cstr, length);
+}
+
+String::String(const String &str)
+{
+    copy(str.c_str(), str._len);
+}
+
+String::String(String &&str) : _buffer(str._buffer), _capacity(str._capacity), _len(str._len)
+{
+    str._buffer = nullptr;
+    str._capacity = 0;
+    str._len = 0;
+}
+
+String::String(char c)
+{
+    copy(&c, 1);
+}
+
+// integer to text in given base, digits are written backwards from end of buffer
+static const char* numberToText(unsigned long long value, bool negative, unsigned char base, char* end)
+{
+    *end = 0;
+    if (base < 2)
+        base = 10;
+    do
+    {
+        int digit = value % base;
+        *--end = (digit < 10) ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value > 0);
+    if (negative)
+        *--end = '-';
+    return end;
+}
+
+#define NUMBER_STRING(value, negative, base) \
+    char text[68]; \
+    const char* first = numberToText(value, negative, base, text + sizeof(text) - 1); \
+    copy(first, text + sizeof(text) - 1 - first);
+
+String::String(unsigned char value, unsigned char base) { NUMBER_STRING(value, false, base) }
+String::String(unsigned int value, unsigned char base) { NUMBER_STRING(value, false, base) }
+String::String(unsigned long value, unsigned char base) { NUMBER_STRING(value, false, base) }
+String::String(unsigned long long value, unsigned char base) { NUMBER_STRING(value, false, base) }
+// negative numbers are shown with sign in base 10 only, like the Arduino core does
+String::String(int value, unsigned char base)
+{
+    bool negative = (value < 0) && (base == DEC);
+    NUMBER_STRING(negative ? -(long long)value : (unsigned int)value, negative, base)
+}
+String::String(long value, unsigned char base)
+{
+    bool negative = (value < 0) && (base == DEC);
+    NUMBER_STRING(negative ? -(long long)value : (unsigned long)value, negative, base)
+}
+String::String(long long value, unsigned char base)
+{
+    bool negative = (value < 0) && (base == DEC);
+    NUMBER_STRING(negative ? -(unsigned long long)value : (unsigned long long)value, negative, base)
+}
+
+String::String(float value, unsigned int decimalPlaces) : String((double)value, decimalPlaces)
+{
+}
+
+String::String(double value, unsigned int decimalPlaces)
+{
+    char text[64];
+    int len = snprintf(text, sizeof(text), "%.*f", decimalPlaces, value);
+    copy(text, (len < (int)sizeof(text)) ? len : sizeof(text)-1);
+}
+
+String::~String()
+{
+    free(_buffer);
+}
+
+String& String::operator=(const String &rhs)
+{
+    if (this != &rhs)
+        copy(rhs.c_str(), rhs._len);
+    return *this;
+}
+
+String& String::operator=(String &&rhs)
+{
+    if (this != &rhs)
+    {
+        free(_buffer);
+        _buffer = rhs._buffer;
+        _capacity = rhs._capacity;
+        _len = rhs._len;
+        rhs._buffer = nullptr;
+        rhs._capacity = 0;
+        rhs._len = 0;
+    }
+    return *this;
+}
+
+String& String::operator=(const char* cstr)
+{
+    return copy(cstr ? cstr : "", cstr ? strlen(cstr) : 0);
+}
+
+bool String::reserve(unsigned int size)
+{
+    if ((_buffer != nullptr) && (_capacity >= size))
+        return true;
+    char* buffer = (char*)realloc(_buffer, size + 1);
+    if (buffer == nullptr)
+        return false;
+    if (_buffer == nullptr)
+        buffer[0] = 0;
+    _buffer = buffer;
+    _capacity = size;
+    return true;
+}
+
+bool String::setLength(unsigned int len)
+{
+    if ((len == 0) && (_buffer == nullptr))
+        return true; // empty strings do not allocate
+    if (!reserve(len))
+        return false;
+    _len = len;
+    _buffer[len] = 0;
+    return true;
+}
+
+String& String::copy(const char* cstr, unsigned int length)
+{
+    if (length == 0)
+        setLength(0);
+    else if (reserve(length))
+    {
+        memmove(_buffer, cstr, length);
+        setLength(length);
+    }
+    return *this;
+}
+
+bool String::concat(const char* cstr)
+{
+    return (cstr != nullptr) && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(const char* cstr, unsigned int length)
+{
+    if (length == 0)
+        return true;
+    // cstr may point into own buffer, which is moved by realloc
+    bool self = (_buffer != nullptr) && (cstr >= _buffer) && (cstr < _buffer + _len);
+    unsigned int offset = self ? cstr - _buffer : 0;
+    unsigned int len = _len;
+    if (!reserve(len + length))
+        return false;
+    memmove(_buffer + len, self ? _buffer + offset : cstr, length);
+    return setLength(len + length);
+}
+
+int String::compareTo(const String &str) const
+{
+    return strcmp(c_str(), str.c_str());
+}
+
+bool String::equals(const String &str) const
+{
+    return (_len == str._len) && (compareTo(str) == 0);
+}
+
+bool String::equals(const char* cstr) const
+{
+    return strcmp(c_str(), cstr ? cstr : "") == 0;
+}
+
+bool String::equalsIgnoreCase(const String &str) const
+{
+    return (_len == str._len) && (strcasecmp(c_str(), str.c_str()) == 0);
+}
+
+bool String::startsWith(const String &prefix) const
+{
+    return (prefix._len <= _len) && (strncmp(c_str(), prefix.c_str(), prefix._len) == 0);
+}
+
+bool String::endsWith(const String &suffix) const
+{
+    return (suffix._len <= _len) && (strcmp(c_str() + _len - suffix._len, suffix.c_str()) == 0);
+}
+
+int String::indexOf(char c, unsigned int fromIndex) const
+{
+    if (fromIndex >= _len)
+        return -1;
+    const char* found = strchr(_buffer + fromIndex, c);
+    return found ? found - _buffer : -1;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+    if (fromIndex >= _len)
+        return -1;
+    const char* found = strstr(_buffer + fromIndex, str.c_str());
+    return found ? found - _buffer : -1;
+}
+
+int String::lastIndexOf(char c) const
+{
+    if (_len == 0)
+        return -1;
+    const char* found = strrchr(_buffer, c);
+    return found ? found - _buffer : -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+    if (beginIndex > endIndex)
+    {
+        unsigned int index = beginIndex;
+        beginIndex = endIndex;
+        endIndex = index;
+    }
+    if (beginIndex >= _len)
+        return String();
+    if (endIndex > _len)
+        endIndex = _len;
+    return String(_buffer + beginIndex, endIndex - beginIndex);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index >= _len)
+        return;
+    if (count > _len - index)
+        count = _len - index;
+    memmove(_buffer + index, _buffer + index + count, _len - index - count);
+    setLength(_len - count);
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if ((_len == 0) || (find._len == 0))
+        return;
+    String result;
+    const char* from = _buffer;
+    const char* found;
+    while ((found = strstr(from, find.c_str())) != nullptr)
+    {
+        result.concat(from, found - from);
+        result.concat(replace);
+        from = found + find._len;
+    }
+    result.concat(from);
+    *this = static_cast<String&&>(result);
+}
+
+void String::toLowerCase()
+{
+    for (unsigned int i=0; i<_len; i++)
+        _buffer[i] = tolower((unsigned char)_buffer[i]);
+}
+
+void String::toUpperCase()
+{
+    for (unsigned int i=0; i<_len; i++)
+        _buffer[i] = toupper((unsigned char)_buffer[i]);
+}
+
+void String::trim()
+{
+    unsigned int begin = 0;
+    unsigned int end = _len;
+    while ((begin < end) && isspace((unsigned char)_buffer[begin]))
+        begin++;
+    while ((end > begin) && isspace((unsigned char)_buffer[end-1]))
+        end--;
+    if ((begin == 0) && (end == _len))
+        return;
+    memmove(_buffer, _buffer + begin, end - begin);
+    setLength(end - begin);
+}
+
+long String::toInt() const
+{
+    return atol(c_str());
+}
+
+float String::toFloat() const
+{
+    return atof(c_str());
+}
+
+double String::toDouble() const
+{
+    return atof(c_str());
+}
+
+String operator+(const String &lhs, const String &rhs)
+{
+    String result;
+    result.reserve(lhs.length() + rhs.length());
+    result.concat(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const String &lhs, const char* rhs)
+{
+    String result;
+    result.reserve(lhs.length() + (rhs ? strlen(rhs) : 0));
+    result.concat(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const char* lhs, const String &rhs)
+{
+    String result;
+    result.reserve((lhs ? strlen(lhs) : 0) + rhs.length());
+    result.concat(lhs);
+    result.concat(rhs);
+    return result;
+}
+
+String operator+(const String &lhs, char rhs)
+{
+    String result(lhs);
+    result.concat(rhs);
+    return result;
+}
@@ -0,0 +1,99 @@
+#ifndef _WSTRING_H_
+#define _WSTRING_H_
+#include <stddef.h>
+#include <stdint.h>
+
+// String of the Arduino core for host builds
+// Memory is managed with realloc() like the ESP32 core does, but short strings are
+// allocated as well (the ESP32 core keeps up to 10 characters in the object).
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String
+{
+public:
+    String(const char* cstr = "");
+    String(const char* cstr, unsigned int length);
+    String(const String &str);
+    String(String &&str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base=DEC);
+    explicit String(int value, unsigned char base=DEC);
+    explicit String(unsigned int value, unsigned char base=DEC);
+    explicit String(long value, unsigned char base=DEC);
+    explicit String(unsigned long value, unsigned char base=DEC);
+    explicit String(long long value, unsigned char base=DEC);
+    explicit String(unsigned long long value, unsigned char base=DEC);
+    explicit String(float value, unsigned int decimalPlaces=2);
+    explicit String(double value, unsigned int decimalPlaces=2);
+    ~String();
+
+    String& operator=(const String &rhs);
+    String& operator=(String &&rhs);
+    String& operator=(const char* cstr);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _len; };
+    bool isEmpty() const { return _len == 0; };
+    const char* c_str() const { return _buffer ? _buffer : ""; };
+    void clear() { setLength(0); };
+
+    bool concat(const String &str) { return concat(str.c_str(), str._len); };
+    bool concat(const char* cstr);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(char c) { return concat(&c, 1); };
+    template <typename T> bool concat(T value) { return concat(String(value)); };
+    template <typename T> String& operator+=(const T &rhs) { concat(rhs); return *this; };
+
+    int compareTo(const String &str) const;
+    bool equals(const String &str) const;
+    bool equals(const char* cstr) const;
+    bool equalsIgnoreCase(const String &str) const;
+    bool operator==(const String &rhs) const { return equals(rhs); };
+    bool operator==(const char* cstr) const { return equals(cstr); };
+    bool operator!=(const String &rhs) const { return !equals(rhs); };
+    bool operator!=(const char* cstr) const { return !equals(cstr); };
+    bool operator<(const String &rhs) const { return compareTo(rhs) < 0; };
+    bool startsWith(const String &prefix) const;
+    bool endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const { return (index < _len) ? _buffer[index] : 0; };
+    void setCharAt(unsigned int index, char c) { if (index < _len) _buffer[index] = c; };
+    char operator[](unsigned int index) const { return charAt(index); };
+
+    int indexOf(char c, unsigned int fromIndex=0) const;
+    int indexOf(const String &str, unsigned int fromIndex=0) const;
+    int lastIndexOf(char c) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _len); };
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); };
+    void remove(unsigned int index, unsigned int count);
+    void replace(const String &find, const String &replace);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    char* _buffer = nullptr;
+    unsigned int _capacity = 0;     // without terminating 0
+    unsigned int _len = 0;
+    bool setLength(unsigned int len);
+    String& copy(const char* cstr, unsigned int length);
+};
+
+// concatenation, numbers are converted as by String(value)
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char* rhs);
+String operator+(const char* lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
+template <typename T> String operator+(const String &lhs, T rhs) { return lhs + String(rhs); }
+
+#endif
@@ -0,0 +1,17 @@
+#include "Arduino.h"
+
+// run Arduino sketch on host: setup() once, then loop() as often as given by
+// first argument (default 1)
+
+void setup();
+void loop();
+
+int main(int argc, char* argv[])
+{
+    long loops = (argc > 1) ? atol(argv[1]) : 1;
+    setup();
+    for (long i=0; i<loops; i++)
+        loop();
+    Serial.flush();
+    return 0;
+}
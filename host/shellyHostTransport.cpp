@@ -0,0 +1,447 @@
+#include "shellyHostTransport.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+// wait for socket to become readable (or writable), false on timeout
+static bool waitSocket(int socket, short events, int timeout)
+{
+    struct pollfd fd = { socket, events, 0 };
+    return poll(&fd, 1, timeout) > 0;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeout)
+{
+    stop();
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &addresses) != 0)
+        return 0;
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0)
+    {
+        freeaddrinfo(addresses);
+        return 0;
+    }
+    // connect non blocking to apply timeout
+    fcntl(s, F_SETFL, O_NONBLOCK);
+    int result = ::connect(s, addresses->ai_addr, addresses->ai_addrlen);
+    freeaddrinfo(addresses);
+    if ((result < 0) && (errno == EINPROGRESS) && waitSocket(s, POLLOUT, timeout))
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(s, SOL_SOCKET, SO_ERROR, &error, &len);
+        result = (error == 0) ? 0 : -1;
+    }
+    if (result < 0)
+    {
+        close(s);
+        return 0;
+    }
+    fcntl(s, F_SETFL, 0); // writes block, reads use MSG_DONTWAIT
+    _socket = s;
+    return 1;
+}
+
+uint8_t WiFiClient::connected()
+{
+    if (_rxPos < _rxLen)
+        return 1;
+    if (_socket < 0)
+        return 0;
+    char c;
+    int n = recv(_socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if ((n > 0) || ((n < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))))
+        return 1;
+    stop(); // closed by server or error
+    return 0;
+}
+
+void WiFiClient::stop()
+{
+    if (_socket >= 0)
+        close(_socket);
+    _socket = -1;
+    _rxPos = 0;
+    _rxLen = 0;
+}
+
+int WiFiClient::setNoDelay(bool noDelay)
+{
+    int flag = noDelay;
+    return (_socket >= 0) ? setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag)) : -1;
+}
+
+bool WiFiClient::wait(uint32_t timeout)
+{
+    if (_rxPos < _rxLen)
+        return true;
+    return (_socket >= 0) && waitSocket(_socket, POLLIN, timeout);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size)
+{
+    size_t sent = 0;
+    while ((_socket >= 0) && (sent < size))
+    {
+        ssize_t n = send(_socket, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+    return sent;
+}
+
+bool WiFiClient::fill()
+{
+    if (_rxPos < _rxLen)
+        return true;
+    if (_socket < 0)
+        return false;
+    ssize_t n = recv(_socket, _rx, sizeof(_rx), MSG_DONTWAIT);
+    _rxPos = 0;
+    _rxLen = (n > 0) ? n : 0;
+    return n > 0;
+}
+
+int WiFiClient::available()
+{
+    int n = 0;
+    if ((_socket >= 0) && (ioctl(_socket, FIONREAD, &n) < 0))
+        n = 0;
+    return (_rxLen - _rxPos) + n;
+}
+
+int WiFiClient::read()
+{
+    return fill() ? _rx[_rxPos++] : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size)
+{
+    if (!fill())
+        return -1;
+    size_t n = min(size, _rxLen - _rxPos);
+    memcpy(buffer, _rx + _rxPos, n);
+    _rxPos += n;
+    return n;
+}
+
+int WiFiClient::peek()
+{
+    return fill() ? _rx[_rxPos] : -1;
+}
+
+// start new request on client
+void HTTPClient::prepare(WiFiClient &client)
+{
+    _client = &client;
+    _headers.clear();
+    _headerCount = 0;
+    _size = -1;
+    _chunked = false;
+    _canReuse = false;
+}
+
+bool HTTPClient::begin(WiFiClient &client, const String &url)
+{
+    prepare(client);
+    if (!url.startsWith("http://"))
+        return false;
+    // buffers of _host and _uri are reused by following requests
+    const char* host = url.c_str() + 7;
+    const char* path = strchr(host, '/');
+    const char* colon = strchr(host, ':');
+    if ((colon != nullptr) && (path != nullptr) && (colon > path))
+        colon = nullptr;
+    const char* end = (colon != nullptr) ? colon : (path != nullptr) ? path : host + strlen(host);
+    _host.clear();
+    _host.concat(host, end - host);
+    _port = (colon != nullptr) ? atoi(colon + 1) : 80;
+    _uri = (path != nullptr) ? path : "/";
+    return true;
+}
+
+// arguments by value like HTTPClient of the ESP32 core, so allocations are the same
+bool HTTPClient::begin(WiFiClient &client, String host, uint16_t port, String uri, bool https)
+{
+    prepare(client);
+    if (https)
+        return false;
+    _host = host;
+    _port = port;
+    _uri = uri;
+    return true;
+}
+
+void HTTPClient::end()
+{
+    if ((_client == nullptr) || !_client->connected())
+        return;
+    if (_reuse && _canReuse)
+    {
+        uint8_t buffer[64];
+        while (_client->read(buffer, sizeof(buffer)) > 0)
+            ; // discard rest of response
+    }
+    else
+        _client->stop();
+}
+
+bool HTTPClient::connected()
+{
+    return (_client != nullptr) && _client->connected();
+}
+
+void HTTPClient::addHeader(const String &name, const String &value, bool /*first*/, bool /*replace*/)
+{
+    _headers += name;
+    _headers += ": ";
+    _headers += value;
+    _headers += "\r\n";
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount)
+{
+    _headerCount = min(headerKeysCount, (size_t)HTTPCLIENT_MAX_HEADERS);
+    for (size_t i=0; i<_headerCount; i++)
+    {
+        _headerKeys[i] = headerKeys[i];
+        _headerValues[i].clear();
+    }
+}
+
+String HTTPClient::header(const char* name)
+{
+    for (size_t i=0; i<_headerCount; i++)
+        if (strcasecmp(_headerKeys[i], name) == 0)
+            return _headerValues[i];
+    return String();
+}
+
+String HTTPClient::header(unsigned int i)
+{
+    return (i < _headerCount) ? _headerValues[i] : String();
+}
+
+bool HTTPClient::hasHeader(const char* name)
+{
+    return header(name).length() > 0;
+}
+
+int HTTPClient::sendRequest(const char* method, const uint8_t* payload, size_t size)
+{
+    if (_client == nullptr)
+        return HTTPC_ERROR_NOT_CONNECTED;
+    if (!_client->connected() && !_client->connect(_host.c_str(), _port, _connectTimeout))
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    for (size_t i=0; i<_headerCount; i++)
+        _headerValues[i].clear();
+    // request header written at once
+    char start[64];
+    start[0] = 0;
+    if (_port != 80)
+        snprintf(start, sizeof(start), ":%u", (unsigned)_port);
+    String request;
+    request.reserve(128 + _uri.length() + _host.length() + _headers.length());
+    request += method;
+    request += " ";
+    request += _uri;
+    request += " HTTP/1.1\r\nHost: ";
+    request += _host;
+    request += start;
+    request += "\r\nUser-Agent: ESP32HTTPClient\r\nConnection: ";
+    request += _reuse ? "keep-alive\r\n" : "close\r\n";
+    if (payload != nullptr)
+    {
+        snprintf(start, sizeof(start), "Content-Length: %lu\r\n", (unsigned long)size);
+        request += start;
+    }
+    request += _headers;
+    request += "\r\n";
+    if (_client->write((const uint8_t*)request.c_str(), request.length()) != request.length())
+        return HTTPC_ERROR_SEND_HEADER_FAILED;
+    if ((payload != nullptr) && (_client->write(payload, size) != size))
+        return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    return readResponseHeader();
+}
+
+// read line without line end, false on timeout or connection closed
+// excess characters of long lines are skipped
+bool HTTPClient::readLine(char* line, size_t size)
+{
+    size_t len = 0;
+    line[0] = 0;
+    unsigned long start = millis();
+    while (true)
+    {
+        int c = _client->read();
+        if (c == '\n')
+            return true;
+        if (c >= 0)
+        {
+            if ((c != '\r') && (len < size-1))
+            {
+                line[len++] = c;
+                line[len] = 0;
+            }
+            continue;
+        }
+        long remaining = (long)_timeout - (long)(millis() - start);
+        if ((remaining <= 0) || !_client->connected())
+            return false;
+        _client->wait(remaining);
+    }
+}
+
+// HTTP/1.1 200 OK
+// Content-Length: 205
+int HTTPClient::readResponseHeader()
+{
+    char line[400]; // large enough for WWW-Authenticate
+    if (!readLine(line, sizeof(line)))
+        return _client->connected() ? HTTPC_ERROR_READ_TIMEOUT : HTTPC_ERROR_CONNECTION_LOST;
+    if (strncmp(line, "HTTP/1.", 7) != 0)
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+    int code = atoi(line + 9);
+    _canReuse = (line[7] == '1'); // HTTP/1.1 keeps connection by default
+    _size = -1;
+    _chunked = false;
+    while (readLine(line, sizeof(line)) && (line[0] != 0))
+    {
+        char* value = strchr(line, ':');
+        if (value == nullptr)
+            continue;
+        *value++ = 0;
+        while (*value == ' ')
+            value++;
+        if (strcasecmp(line, "Content-Length") == 0)
+            _size = atoi(value);
+        else if (strcasecmp(line, "Transfer-Encoding") == 0)
+            _chunked = (strcasecmp(value, "chunked") == 0);
+        else if (strcasecmp(line, "Connection") == 0)
+            _canReuse = (strcasecmp(value, "close") != 0);
+        for (size_t i=0; i<_headerCount; i++)
+            if (strcasecmp(line, _headerKeys[i]) == 0)
+                _headerValues[i] = value;
+    }
+    if ((_size < 0) && !_chunked)
+        _canReuse = false; // body ends with connection
+    return code;
+}
+
+// read length bytes of body to out, length -1 reads up to end of connection
+int HTTPClient::readBytes(Print &out, size_t length)
+{
+    uint8_t buffer[512];
+    size_t total = 0;
+    unsigned long start = millis();
+    while (total < length)
+    {
+        int n = _client->read(buffer, min(sizeof(buffer), length - total));
+        if (n > 0)
+        {
+            if (out.write(buffer, n) != (size_t)n)
+                return HTTPC_ERROR_STREAM_WRITE;
+            total += n;
+            start = millis();
+            continue;
+        }
+        if (!_client->connected())
+            return (length == (size_t)-1) ? (int)total : HTTPC_ERROR_CONNECTION_LOST;
+        if (millis() - start > _timeout)
+            return HTTPC_ERROR_READ_TIMEOUT;
+        _client->wait(_timeout);
+    }
+    return total;
+}
+
+int HTTPClient::readBody(Print &out)
+{
+    if (!_chunked)
+        return readBytes(out, (_size >= 0) ? (size_t)_size : (size_t)-1);
+    int total = 0;
+    char line[64];
+    while (readLine(line, sizeof(line)))
+    {
+        size_t length = strtoul(line, nullptr, 16);
+        if (length == 0) // last chunk, skip trailer
+        {
+            while (readLine(line, sizeof(line)) && (line[0] != 0))
+                ;
+            return total;
+        }
+        int n = readBytes(out, length);
+        if (n < 0)
+            return n;
+        total += n;
+        readLine(line, sizeof(line)); // end of chunk
+    }
+    return HTTPC_ERROR_READ_TIMEOUT;
+}
+
+// collects body in String
+class stringPrint : public Print
+{
+public:
+    stringPrint(String &text) : _text(text) {};
+    size_t write(uint8_t c) override { _text += (char)c; return 1; };
+    size_t write(const uint8_t* buffer, size_t size) override { return _text.concat((const char*)buffer, size) ? size : 0; };
+private:
+    String &_text;
+};
+
+String HTTPClient::getString()
+{
+    String payload;
+    if (_client == nullptr)
+        return payload;
+    if (_size > 0)
+        payload.reserve(_size);
+    stringPrint out(payload);
+    if (readBody(out) < 0)
+        _canReuse = false;
+    return payload;
+}
+
+int HTTPClient::writeToStream(Stream* stream)
+{
+    if (stream == nullptr)
+        return HTTPC_ERROR_NO_STREAM;
+    if ((_client == nullptr) || !_client->connected())
+        return HTTPC_ERROR_NOT_CONNECTED;
+    int written = readBody(*stream);
+    if (written < 0)
+        _canReuse = false;
+    return written;
+}
+
+String HTTPClient::errorToString(int error)
+{
+    switch (error)
+    {
+    case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+    case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+    case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+    case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+    case HTTPC_ERROR_NO_STREAM: return "no stream";
+    case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+    case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+    case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+    case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+    case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+    default: return String();
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef _SHELLYHOSTTRANSPORT_H_
+#define _SHELLYHOSTTRANSPORT_H_
+#include "Arduino.h"
+
+// network transport of the library for host builds, see src/shellyTransport.h
+// WiFiClient (TCP connection) and HTTPClient (HTTP/1.1 requests) with the interface
+// of the ESP32 core, limited to what the library uses, over POSIX sockets.
+
+// TCP connection, reads do not block, received data is buffered like on ESP32
+class WiFiClient : public Stream
+{
+public:
+    WiFiClient() {};
+    ~WiFiClient() { stop(); };
+    WiFiClient(const WiFiClient&) = delete; // owns socket
+    WiFiClient& operator=(const WiFiClient&) = delete;
+    int connect(const char* host, uint16_t port) { return connect(host, port, 3000); };
+    int connect(const char* host, uint16_t port, int32_t timeout); // timeout [ms]
+    uint8_t connected();        // true while data is available or connection is open
+    void stop();
+    int setNoDelay(bool noDelay);
+    size_t write(uint8_t c) override { return write(&c, 1); };
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;        // -1 if no data available
+    int read(uint8_t* buffer, size_t size);
+    int peek() override;
+    operator bool() { return connected(); };
+    bool wait(uint32_t timeout); // host only: wait for data [ms], false on timeout
+private:
+    int _socket = -1;
+    uint8_t _rx[1460];          // one TCP segment
+    size_t _rxPos = 0;
+    size_t _rxLen = 0;
+    bool fill();                // receive to empty buffer, false if no data
+};
+
+// HTTP response codes and errors of HTTPClient
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_CONNECTION_LOST     (-5)
+#define HTTPC_ERROR_NO_STREAM           (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER      (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM        (-8)
+#define HTTPC_ERROR_ENCODING            (-9)
+#define HTTPC_ERROR_STREAM_WRITE        (-10)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+enum t_http_codes
+{
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_FORBIDDEN = 403,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_BAD_GATEWAY = 502
+};
+
+#ifndef HTTPCLIENT_MAX_HEADERS
+#define HTTPCLIENT_MAX_HEADERS 4 // response headers collected
+#endif
+
+// HTTP/1.1 requests over a WiFiClient, connection is kept open if reuse is set
+class HTTPClient
+{
+public:
+    bool begin(WiFiClient &client, const String &url); // url like http://host:port/path
+    bool begin(WiFiClient &client, String host, uint16_t port, String uri="/", bool https=false);
+    void end();                 // finish request, keep connection if possible
+    int GET() { return sendRequest("GET"); };
+    int POST(const String &payload) { return sendRequest("POST", (const uint8_t*)payload.c_str(), payload.length()); };
+    int POST(uint8_t* payload, size_t size) { return sendRequest("POST", payload, size); };
+    // returns HTTP response code or HTTPC_ERROR_...
+    int sendRequest(const char* method, const uint8_t* payload=nullptr, size_t size=0);
+    void setReuse(bool reuse) { _reuse = reuse; };
+    void setTimeout(uint16_t timeout) { _timeout = timeout; };             // read timeout [ms]
+    void setConnectTimeout(int32_t timeout) { _connectTimeout = timeout; }; // [ms]
+    void setAuthorizationType(const char* /*authType*/) {}; // authorization is added by caller
+    void addHeader(const String &name, const String &value, bool first=false, bool replace=true);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+    String header(unsigned int i); // size_t on ESP32
+    bool hasHeader(const char* name);
+    int getSize() { return _size; }; // content length, -1 if unknown
+    bool connected();
+    WiFiClient* getStreamPtr() { return _client; };
+    WiFiClient& getStream() { return *_client; };
+    String getString();         // read body
+    int writeToStream(Stream* stream); // write body to stream, returns bytes written or HTTPC_ERROR_...
+    static String errorToString(int error);
+private:
+    WiFiClient* _client = nullptr;
+    String _host;
+    uint16_t _port = 80;
+    String _uri;
+    String _headers;            // added request headers
+    bool _reuse = true;
+    bool _canReuse = false;     // response allows to keep connection
+    uint16_t _timeout = 5000;
+    int32_t _connectTimeout = 3000;
+    const char* _headerKeys[HTTPCLIENT_MAX_HEADERS];
+    String _headerValues[HTTPCLIENT_MAX_HEADERS];
+    size_t _headerCount = 0;
+    int _size = -1;
+    bool _chunked = false;
+    int readResponseHeader();
+    void prepare(WiFiClient &client);
+    bool readLine(char* line, size_t size);
+    int readBody(Print &out);   // returns bytes read or HTTPC_ERROR_...
+    int readBytes(Print &out, size_t length);
+};
+
+#endif
@@ -1,8 +1,13 @@
 #include "shellyDevice.h"
-#include <WiFi.h>
-#include <HTTPClient.h>
 #include <Crypto.h> // An extremely minimal crypto library for Arduino devices by Chris Ellis
 
+// statements only compiled if request statistics are enabled, see shellyStats.h
+#if SHELLY_STATS
+#define STATS(...) __VA_ARGS__
+#else
+#define STATS(...)
+#endif
+
 // extract parameter value starting after "param" up to (excluding) delimiter
 String shellyDevice::extractParam(String s, String param, char delimiter) 
 {
@@ -12,133 +17,676 @@ String shellyDevice::extractParam(String s, String param, char delimiter)
     return s.substring(_begin + param.length(), s.indexOf(delimiter, _begin + param.length()));
 }
 
-// calculate SHA256 hash for string s
-String shellyDevice::SHA256hash(String s)
+// append data to buffer, excess data is discarded but reported as written
+// to keep reading the response in sync
+size_t shellyBuffer::write(const uint8_t *buffer, size_t size)
+{
+    if (_size == 0)
+    {
+        _truncated |= (size > 0);
+        return size;
+    }
+    size_t n = size;
+    if (n > _size - 1 - _length)
+    {
+        n = _size - 1 - _length;
+        _truncated = true;
+    }
+    memcpy(_buffer + _length, buffer, n);
+    _length += n;
+    _buffer[_length] = 0;
+    return size;
+}
+
+// copy parameter value starting after "param" up to (excluding) delimiter or end of s to dest
+// returns false if param not found or value truncated to fit into dest
+static bool copyParam(const char* s, const char* param, char delimiter, char* dest, size_t size)
+{
+    dest[0] = 0;
+    const char* _begin = strstr(s, param);
+    if (_begin == NULL) 
+        return false; // not found
+    _begin += strlen(param);
+    const char* _end = strchr(_begin, delimiter);
+    size_t len = (_end == NULL) ? strlen(_begin) : (size_t)(_end - _begin);
+    bool fits = len < size;
+    if (!fits)
+        len = size-1;
+    memcpy(dest, _begin, len);
+    dest[len] = 0;
+    return fits;
+}
+
+// finish SHA256 hash and write it to hex as lower case hex string (2*SHA256_SIZE+1 chars)
+static void SHA256hex(SHA256 &sha, char* hex)
 {
+    static const char hexDigits[] = "0123456789abcdef"; // lookup table
+    byte hash[SHA256_SIZE];
+    sha.doFinal(hash);
+    for (int i=0; i<SHA256_SIZE; i++)
+    {
+        *hex++ = hexDigits[hash[i] >> 4];
+        *hex++ = hexDigits[hash[i] & 0x0f];
+    }
+    *hex = 0;
+}
+
+// store realm of authentication challenge
+// HA1 = SHA256(username ":" realm ":" password) is recalculated if realm has changed
+void shellyDevice::setRealm(const char* realm)
+{
+    if ((strcmp(realm, _realm) != 0) || (_HA1[0] == 0))
+    {
+        strncpy(_realm, realm, sizeof(_realm)-1);
+        _realm[sizeof(_realm)-1] = 0;
+        SHA256 sha;
+        sha.doUpdate(_user.c_str());
+        sha.doUpdate(":");
+        sha.doUpdate(_realm);
+        sha.doUpdate(":");
+        sha.doUpdate(_password.c_str());
+        SHA256hex(sha, _HA1);
+    }
+}
+
+// calculate digest response SHA256(HA1:nonce:nc:cnonce:qop:HA2) with HA2 = SHA256(method:uri)
+// pieces are fed to the hash directly, so no temporary strings are required
+void shellyDevice::digestResponse(const char* method, const char* uri, 
+    const char* nonce, const char* nc, const char* cnonce, const char* qop, char* response)
+{
+    char HA2[2*SHA256_SIZE+1];
     SHA256 sha;
-    sha.doUpdate(s.c_str());
-    char hash[SHA256_SIZE];
-    sha.doFinal((byte*)hash);
-    String hashStr = "";
-    for (int i=0; i<32; i++)
+    sha.doUpdate(method);
+    sha.doUpdate(":");
+    sha.doUpdate(uri);
+    SHA256hex(sha, HA2);
+
+    sha.reset();
+    sha.doUpdate(_HA1);
+    sha.doUpdate(":");
+    sha.doUpdate(nonce);
+    sha.doUpdate(":");
+    sha.doUpdate(nc);
+    sha.doUpdate(":");
+    sha.doUpdate(cnonce);
+    sha.doUpdate(":");
+    sha.doUpdate(qop);
+    sha.doUpdate(":");
+    sha.doUpdate(HA2);
+    SHA256hex(sha, response);
+}
+
+// store authentication challenge returned by server
+// similar to https://forum.arduino.cc/t/arduino-web-server-http-requests-digest-authentication/531860/55
+void shellyDevice::parseChallenge(const char* AuthHeader)
+{
+    char realm[sizeof(_realm)];
+    copyParam(AuthHeader, "realm=\"", '\"', realm, sizeof(realm));
+    copyParam(AuthHeader, "nonce=\"", '\"', _nonce, sizeof(_nonce));
+    copyParam(AuthHeader, "qop=\""  , '\"', _qop, sizeof(_qop));
+    copyParam(AuthHeader, "algorithm=", ',', _algo, sizeof(_algo)); // up to next parameter or end
+    _nc = 0; // new nonce, restart counting
+    setRealm(realm);
+}
+
+// build Authorization header for uri from cached challenge into buffer
+const char* shellyDevice::authorization(const char* uri, char* buffer, size_t size, const char* httpMethod)
+{
+    char authResponse[2*SHA256_SIZE+1];
+    char nc[12];
+    char cnonce[12];
+    snprintf(nc, sizeof(nc), "%lu", ++_nc); // count requests using same nonce
+    snprintf(cnonce, sizeof(cnonce), "%ld", random(556822323L)); // clients random number
+    // according to shelly doc HA2 = SHA256("dummy_method:dummy_uri") should work as well but does not
+    digestResponse(httpMethod, uri, _nonce, nc, cnonce, _qop, authResponse);
+
+    snprintf(buffer, size, " Digest"
+        " username="   "\"%s\""
+        ", realm="     "\"%s\""
+        ", nonce="     "\"%s\""
+//        ", uri="       "\"%s\"" // optional, not required by shelly
+        ", algorithm=" "%s" // "SHA-256"
+        ", response="  "\"%s\""
+        ", qop="       "%s" // "auth"
+        ", nc="        "%s" // incremented for each request
+        ", cnonce="    "%s", // random
+        _user.c_str(), _realm, _nonce, _algo, authResponse, _qop, nc, cnonce);
+    return buffer;
+}
+
+// if the server requires authentication we will need the Authenticate header from the response
+static const int NUMHEADERS = 1;
+static const char* AuthHeaders[NUMHEADERS] = {"WWW-Authenticate"};
+
+// close persistent connection if not used for longer than keep alive time
+void shellyDevice::closeIdleConnection()
+{
+    if (_wifi.connected() && (millis() - _lastRequest > _keepAlive))
+        disconnect();
+}
+
+// close persistent connection
+void shellyDevice::disconnect()
+{
+    _wifi.stop();
+}
+
+// _server is "http://host" or "http://host:port", split once for all connections
+void shellyDevice::splitServer()
+{
+    _host = hostHeader();
+    _port = 80;
+    int colon = _host.indexOf(':');
+    if (colon >= 0)
     {
-        hashStr += String(((hash[i]>>4) & 0x0f), HEX) + String((hash[i] & 0x0f), HEX);
+        _port = _host.substring(colon+1).toInt();
+        _host.remove(colon);
     }
-    return hashStr;
 }
 
-String shellyDevice::GET(String rpcMethod)
+// open new connection, also used by shellyPipeline and shellyWebSocket
+bool shellyDevice::connect(WiFiClient &client)
 {
-    WiFiClient wifi;
-    HTTPClient http;
-    int httpResponseCode;
-    String payload = "{}"; 
-    String method = "/rpc/" + rpcMethod;
-
-    http.begin(wifi, _server + method);
-    // if the server requires authentication we will need the Authenticate header from the response
-    const int NUMHEADERS = 1;
-    const char* AuthHeaders[NUMHEADERS] = {"WWW-Authenticate"};
-    http.collectHeaders(AuthHeaders, NUMHEADERS);
-    http.setAuthorizationType("AUTH_NONE"); // force library not to try authentication (does not work with SHA256)
-    // try to read from server
-    httpResponseCode = http.GET();
-
-    bool needAuth = http.hasHeader(AuthHeaders[0]) && (httpResponseCode==HTTP_CODE_UNAUTHORIZED); // server returned authentication challenge
+    return client.connect(_host.c_str(), _port, _connectTimeout);
+}
+
+bool shellyDevice::connect()
+{
+    STATS(unsigned long start = micros();)
+    bool connected = connect(_wifi);
+    STATS(_stats.connects++; _stats.connectTime += micros() - start;)
+    return connected;
+}
+
+// circuit breaker open, also checked by shellyPipeline
+bool shellyDevice::rejected()
+{
+    return down() && (millis() - _lastRequest < _backoff);
+}
+
+// send GET request for uri over persistent connection
+// host and port split at construction, so HTTPClient does not parse an url for each request
+// if the connection kept open has been dropped by the server meanwhile we reconnect once
+int shellyDevice::sendGET(const char* uri, const char* authString)
+{
+    bool reused = _wifi.connected();
+    if (!reused && !connect())
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    _http.setReuse(_keepAlive > 0); // HTTP/1.1 keep-alive
+    _http.begin(_wifi, _host, _port, uri);
+    _http.setTimeout(_readTimeout);
+    _http.collectHeaders(AuthHeaders, NUMHEADERS);
+    _http.setAuthorizationType("AUTH_NONE"); // force library not to try authentication (does not work with SHA256)
+    if (authString != NULL)
+        _http.addHeader("Authorization", authString);
+    STATS(unsigned long start = micros();)
+    int httpResponseCode = _http.GET();
+    STATS(_sendTime = micros() - start; _stats.firstByteTime += _sendTime;)
+    if ((httpResponseCode < 0) && reused) // stale connection, try again with new one
+    {
+        _http.end();
+        disconnect();
+        return sendGET(uri, authString);
+    }
+    return httpResponseCode;
+}
+
+// send request to rpcMethod, handle authentication challenge if required
+// response body is ready to be read from _http, call finishRequest() after reading
+int shellyDevice::request(const char* rpcMethod)
+{
+    STATS(_requestStart = micros();)
+    if (rejected())
+    {
+        STATS(_stats.rejected++;)
+        return SHELLY_ERROR_DOWN; // fail fast, probe not due yet
+    }
+    // url assembled on stack, uri "/rpc/<method>" is used for authentication
+    char url[SHELLY_URL_LEN];
+    int len = snprintf(url, sizeof(url), "%s/rpc/%s", _server.c_str(), rpcMethod);
+    if ((len < 0) || (len >= (int)sizeof(url)))
+        return SHELLY_ERROR_URL;
+    const char* uri = url + _server.length();
+    closeIdleConnection();
+    // if we got a challenge before try to authenticate with cached nonce at first request
+    char authString[320];
+    bool preemptive = (_password.length()>0) && (_HA1[0] != 0);
+    int httpResponseCode = sendGET(uri, preemptive ? authorization(uri, authString, sizeof(authString)) : NULL);
+
+    // server returned authentication challenge (first access or nonce expired)
+    bool needAuth = _http.hasHeader(AuthHeaders[0]) && (httpResponseCode==HTTP_CODE_UNAUTHORIZED);
     if ( needAuth && (_password.length()>0)) // ... and we know about password
     {
-        String AuthHeader = http.header(0U); // get authentication challenge
-        http.end(); // end the old request
-// similar to https://forum.arduino.cc/t/arduino-web-server-http-requests-digest-authentication/531860/55
-        String AuthMethod = AuthHeader.substring(0,AuthHeader.indexOf(' ')); // up to first space
-        String realm = extractParam(AuthHeader, "realm=\"", '\"');
-        String nonce = extractParam(AuthHeader, "nonce=\"", '\"');
-        String qop   = extractParam(AuthHeader, "qop=\""  , '\"');
-        String algo  = AuthHeader.substring(AuthHeader.indexOf("algorithm=")+10); // algorithm= to end
-
-        // HA1 = SHA256(username ":" realm ":" password)
-        String HA1   = SHA256hash(_user+":"+realm+":"+_password); // TODO as SHA-256
-        
-        // according to shelly doc HA2 = SHA256("dummy_method:dummy_uri") should work as well but does not
-//        String HA2 = SHA256hash("dummy_method:dummy_uri");
-        String HA2 = SHA256hash("GET:" + method);
-
-        String nc = "1"; // constant client number
-        String cnonce = String(random(556822323L)); // clients random number
-        // SHA256(HA1:nonce:nc:cnonce:qop:HA2)
-        String authResponse = SHA256hash(HA1+":"+nonce+":"+nc+":"+cnonce+":"+qop+":"+HA2); 
-
-        String authString = " Digest"
-            " username="   "\"" + _user  + "\""
-            ", realm="     "\"" + realm  + "\""
-            ", nonce="     "\"" + nonce  + "\"" 
-//            ", uri="       "\"" + method + "\"" // optional, not required by shelly
-            ", algorithm=" + algo + // "SHA-256"
-            ", response="  "\"" + authResponse + "\""
-            ", qop="       + qop + // "auth"
-            ", nc="        + nc +  // 1
-            ", cnonce="    + cnonce; // random
+        STATS(unsigned long start = micros();)
+        parseChallenge(_http.header(0U).c_str()); // get authentication challenge
+        _http.getString(); // discard body to keep connection in sync
+        _http.end(); // end the old request
+        _authChallenges++;
         // try with authentication added
-        http.begin(wifi, _server + method);
-        http.setAuthorizationType("AUTH_NONE"); // force library not to try authentication (does not work with SHA256)
-        http.addHeader("Authorization", authString);
-        httpResponseCode = http.GET(); // retry with authentication
+        httpResponseCode = sendGET(uri, authorization(uri, authString, sizeof(authString)));
+        // whole additional round trip is accounted as authentication time
+        STATS(_stats.authChallenges++; _stats.authTime += micros() - start; _stats.firstByteTime -= _sendTime;)
     }
+    else if (preemptive && (httpResponseCode == HTTP_CODE_OK))
+        _authAvoided++; // cached nonce accepted, saved one round trip
+    return httpResponseCode;
+}
+
+// circuit breaker, mark device down after repeated connection errors or timeouts
+// HTTP error codes returned by the device do not count as failure
+void shellyDevice::checkHealth(int httpResponseCode)
+{
+    if (httpResponseCode > 0)
+    {
+        _failures = 0;
+        _backoff = 0;
+    }
+    else if (down()) // probe failed
+        _backoff = min(2*_backoff, (unsigned long)SHELLY_BACKOFF_MAX);
+    else if (++_failures >= SHELLY_DOWN_AFTER)
+        _backoff = SHELLY_BACKOFF_MIN;
+}
+
+// end request, connection is kept open for next request if possible
+void shellyDevice::finishRequest(int httpResponseCode, const char* rpcMethod)
+{
+    if ((httpResponseCode == SHELLY_ERROR_DOWN) || (httpResponseCode == SHELLY_ERROR_URL))
+        return; // nothing has been sent
+    _http.end();
+    if ((httpResponseCode != HTTP_CODE_OK) || (_keepAlive == 0))
+        disconnect(); // do not reuse connection in unknown state
+    _lastRequest = millis(); // backoff of device down counts from here
+    checkHealth(httpResponseCode);
+#if SHELLY_STATS
+    unsigned long ms = (micros() - _requestStart) / 1000;
+    shellyMethodStats &method = _stats.method(rpcMethod);
+    _stats.requests++;
+    _stats.latency.add(ms);
+    method.latency.add(ms);
+    if (httpResponseCode != HTTP_CODE_OK)
+    {
+        _stats.failures++;
+        method.failures++;
+    }
+#endif
+}
+
+#if SHELLY_STATS
+// time spent in json while reading the body is moved from body to parse time
+void shellyDevice::parsed(shellyJsonScanner &json)
+{
+    _stats.parseTime += json.parseTime();
+    _stats.bodyTime -= json.parseTime();
+}
+#endif
+
+String shellyDevice::GET(const char* rpcMethod)
+{
+    String payload = "{}"; 
+    GET(rpcMethod, payload);
+    return payload; // actual response or {"httpResponse": code}
+}
+
+int shellyDevice::GET(const char* rpcMethod, String &payload)
+{
+    int httpResponseCode = request(rpcMethod);
 
     // check server's response
     if (httpResponseCode == 200) // OK
-        payload = http.getString();
+    {
+        STATS(unsigned long start = micros();)
+        payload = _http.getString();
+        STATS(_stats.bodyTime += micros() - start; _stats.bytes += payload.length();)
+    }
     else // return http response code as JSON string
         payload = "{\"httpResponse\": " + String(httpResponseCode) + "}";
-    http.end(); // Free resources
-    return payload; // actual response or empty json object {}
+    finishRequest(httpResponseCode, rpcMethod); // free resources
+    return httpResponseCode;
 }
 
-int shellyWiFi::WiFiRSSI()
+int shellyDevice::GET(const char* rpcMethod, Stream &stream)
 {
-    String response = WiFiGetStatus();
-    // returns something like {"sta_ip":"192.168.178.210","status":"got ip","ssid":"FRITZ!e24","rssi":-51}
-    return extractParam(response, "\"rssi\":", '}').toInt();
+    int httpResponseCode = request(rpcMethod);
+
+    // pass server's response to stream
+    if (httpResponseCode == 200) // OK
+    {
+        STATS(unsigned long start = micros();)
+        int written = _http.writeToStream(&stream);
+        if (written < 0)
+            httpResponseCode = written; // error while reading response
+        STATS(_stats.bodyTime += micros() - start; if (written > 0) _stats.bytes += written;)
+    }
+    finishRequest(httpResponseCode, rpcMethod); // free resources
+    return httpResponseCode;
 }
 
-float shellyCover::TemperatureDegC(uint8_t id)
+int shellyDevice::GET(const char* rpcMethod, char* buffer, size_t size, bool* truncated)
 {
-    String response = CoverGetStatus(id);
-    // returns something like {"id":0, ... ,"temperature":{"tC":33.1, "tF":91.6}}
-    return extractParam(response, "\"tC\":", ',').toFloat();
+    shellyBuffer response(buffer, size);
+    int httpResponseCode = GET(rpcMethod, response);
+    if (httpResponseCode != HTTP_CODE_OK)
+        response.clear(); // do not return partial response
+    if (truncated != NULL)
+        *truncated = response.truncated();
+    return httpResponseCode;
+}
+
+String shellyDevice::GETf(const char* format, ...)
+{
+    char rpcMethod[SHELLY_METHOD_LEN];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(rpcMethod, sizeof(rpcMethod), format, args);
+    va_end(args);
+    if ((len < 0) || (len >= (int)sizeof(rpcMethod)))
+        return "{\"httpResponse\": " + String(SHELLY_ERROR_URL) + "}"; // do not send truncated method
+    return GET(rpcMethod);
+}
+
+// ============================================================================
+// status snapshots
+
+bool shellyDevice::refresh()
+{
+    // something like {"ble":{}, ... ,"input:0":{"id":0,"state":false}, ... ,"switch:0":{"id":0, ...}, ... ,"wifi":{"sta_ip": ...}}
+    shellyJsonScanner json([this](const char* path, const char* value) { decodeShellyStatus(path, value); });
+    bool ok = GET(shellyRpc::ShellyGetStatus, json) == HTTP_CODE_OK;
+    STATS(parsed(json);)
+    return ok;
+}
+
+const char* shellyDevice::componentField(const char* path, const char* component, uint8_t* id)
+{
+    size_t len = strlen(component);
+    if (strncmp(path, component, len) != 0)
+        return NULL;
+    path += len;
+    if (id != NULL) // expect ":id"
+    {
+        if ((*path++ != ':') || !isdigit(*path))
+            return NULL;
+        int n = 0;
+        while (isdigit(*path))
+            n = 10*n + (*path++ - '0');
+        if (n > 255)
+            return NULL;
+        *id = n;
+    }
+    return (*path == '.') ? path+1 : NULL;
+}
+
+bool shellyDevice::isFresh(const shellyStatus &status, uint8_t id)
+{
+    unsigned long age = millis() - status.updated;
+    if (_invalid && (millis() - _invalidated >= _statusTTL))
+        _invalid = false; // snapshots read before have expired anyway
+    return status.valid && (status.id == id) && (age < _statusTTL) &&
+        !(_invalid && (age > millis() - _invalidated));
+}
+
+void shellyDevice::invalidateStatus()
+{
+    _invalidated = millis();
+    _invalid = true;
+}
+
+// read status using rpcMethod, response is decoded by json while reading
+bool shellyDevice::readStatus(const char* rpcMethod, shellyStatus &status, uint8_t id, shellyJsonScanner &json, bool withId)
+{
+    char method[SHELLY_METHOD_LEN];
+    if (withId)
+    {
+        snprintf(method, sizeof(method), "%s?id=%u", rpcMethod, id);
+        rpcMethod = method;
+    }
+    status.id = id;
+    status.valid = (GET(rpcMethod, json) == HTTP_CODE_OK);
+    STATS(parsed(json);)
+    if (status.valid)
+        status.updated = millis();
+    return status.valid;
+}
+
+const shellyWiFiStatus& shellyWiFi::WiFiStatus()
+{
+    if (!isFresh(_wifiStatus, 0))
+        WiFiRefresh();
+    return _wifiStatus;
+}
+
+bool shellyWiFi::WiFiRefresh()
+{
+    shellyJsonScanner json([this](const char* path, const char* value) { WiFiDecode(_wifiStatus, path, value); });
+    return readStatus(shellyRpc::WiFiGetStatus, _wifiStatus, 0, json, false);
+}
+
+void shellyWiFi::WiFiDecode(shellyWiFiStatus &status, const char* path, const char* value)
+{
+    // something like {"sta_ip":"192.168.178.210","status":"got ip","ssid":"FRITZ!e24","rssi":-51}
+    if (strcmp(path, "rssi") == 0)
+        status.rssi = atoi(value);
+}
+
+void shellyWiFi::decodeShellyStatus(const char* path, const char* value)
+{
+    const char* field = componentField(path, "wifi", NULL);
+    if (field != NULL)
+        WiFiDecode(markStatus(_wifiStatus, 0), field, value);
+}
+
+const shellyInputStatus& shellyInput::InputStatus(uint8_t id)
+{
+    shellyInputStatus &status = statusSlot(_inputStatus, id);
+    if (!isFresh(status, id))
+        InputRefresh(id);
+    return status;
+}
+
+bool shellyInput::InputRefresh(uint8_t id)
+{
+    shellyInputStatus &status = statusSlot(_inputStatus, id);
+    shellyJsonScanner json([this, &status](const char* path, const char* value) { InputDecode(status, path, value); });
+    return readStatus(shellyRpc::InputGetStatus, status, id, json);
+}
+
+void shellyInput::InputDecode(shellyInputStatus &status, const char* path, const char* value)
+{
+    // something like {"id":0,"state":false}
+    if (strcmp(path, "state") == 0)
+        status.state = shellyJsonBool(value);
+}
+
+void shellyInput::decodeShellyStatus(const char* path, const char* value)
+{
+    uint8_t id;
+    const char* field = componentField(path, "input", &id);
+    if (field != NULL)
+        InputDecode(markStatus(statusSlot(_inputStatus, id), id), field, value);
+}
+
+const shellyCoverStatus& shellyCover::CoverStatus(uint8_t id)
+{
+    shellyCoverStatus &status = statusSlot(_coverStatus, id);
+    if (!isFresh(status, id))
+        CoverRefresh(id);
+    return status;
+}
+
+bool shellyCover::CoverRefresh(uint8_t id)
+{
+    shellyCoverStatus &status = statusSlot(_coverStatus, id);
+    shellyJsonScanner json([this, &status](const char* path, const char* value) { CoverDecode(status, path, value); });
+    return readStatus(shellyRpc::CoverGetStatus, status, id, json);
+}
+
+void shellyCover::CoverDecode(shellyCoverStatus &status, const char* path, const char* value)
+{
+    // something like {"id":0, "source":"init", "state":"stopped", "apower":0.0, "voltage":231.3, "current":0.000,...
+    //   "temperature":{"tC":33.1, "tF":91.6}, ... "current_pos":100}
+    if (strcmp(path, "apower") == 0)
+        status.apower = atof(value);
+    else if (strcmp(path, "voltage") == 0)
+        status.voltage = atof(value);
+    else if (strcmp(path, "current") == 0)
+        status.current = atof(value);
+    else if (strcmp(path, "temperature.tC") == 0)
+        status.tC = atof(value);
+    else if (strcmp(path, "current_pos") == 0)
+        status.position = atoi(value);
+}
+
+void shellyCover::decodeShellyStatus(const char* path, const char* value)
+{
+    uint8_t id;
+    const char* field = componentField(path, "cover", &id);
+    if (field != NULL)
+        CoverDecode(markStatus(statusSlot(_coverStatus, id), id), field, value);
+}
+
+const shellySwitchStatus& shellySwitch::SwitchStatus(uint8_t id)
+{
+    shellySwitchStatus &status = statusSlot(_switchStatus, id);
+    if (!isFresh(status, id))
+        SwitchRefresh(id);
+    return status;
+}
+
+bool shellySwitch::SwitchRefresh(uint8_t id)
+{
+    shellySwitchStatus &status = statusSlot(_switchStatus, id);
+    shellyJsonScanner json([this, &status](const char* path, const char* value) { SwitchDecode(status, path, value); });
+    return readStatus(shellyRpc::SwitchGetStatus, status, id, json);
+}
+
+void shellySwitch::SwitchDecode(shellySwitchStatus &status, const char* path, const char* value)
+{
+    // something like {"id":0, "source":"init", "output":false, "apower":0.0, "voltage":231.3, "current":0.000,...
+    //   "temperature":{"tC":33.1, "tF":91.6}}
+    if (strcmp(path, "output") == 0)
+        status.output = shellyJsonBool(value);
+    else if (strcmp(path, "apower") == 0)
+    {
+        status.apower = atof(value);
+        shellySeriesBase* series = statusSlot(_activePowerSeries, status.id);
+        if (series != NULL)
+            series->add(status.apower, millis());
+    }
+    else if (strcmp(path, "voltage") == 0)
+        status.voltage = atof(value);
+    else if (strcmp(path, "current") == 0)
+        status.current = atof(value);
+    else if (strcmp(path, "temperature.tC") == 0)
+        status.tC = atof(value);
+}
+
+void shellySwitch::decodeShellyStatus(const char* path, const char* value)
+{
+    uint8_t id;
+    const char* field = componentField(path, "switch", &id);
+    if (field != NULL)
+        SwitchDecode(markStatus(statusSlot(_switchStatus, id), id), field, value);
+}
+
+const shellyTemperatureStatus& shellyTemperature::TemperatureStatus(uint8_t id)
+{
+    shellyTemperatureStatus &status = statusSlot(_temperatureStatus, id);
+    if (!isFresh(status, id))
+        TemperatureRefresh(id);
+    return status;
+}
+
+bool shellyTemperature::TemperatureRefresh(uint8_t id)
+{
+    shellyTemperatureStatus &status = statusSlot(_temperatureStatus, id);
+    shellyJsonScanner json([this, &status](const char* path, const char* value) { TemperatureDecode(status, path, value); });
+    return readStatus(shellyRpc::TemperatureGetStatus, status, id, json);
+}
+
+void shellyTemperature::TemperatureDecode(shellyTemperatureStatus &status, const char* path, const char* value)
+{
+    // something like {"id": 0,"tC":27.5, "tF":81.5}
+    if (strcmp(path, "tC") == 0)
+        status.tC = atof(value);
+}
+
+void shellyTemperature::decodeShellyStatus(const char* path, const char* value)
+{
+    uint8_t id;
+    const char* field = componentField(path, "temperature", &id);
+    if (field != NULL)
+        TemperatureDecode(markStatus(statusSlot(_temperatureStatus, id), id), field, value);
+}
+
+const shellyEMStatus& shellyEM::EMStatus(uint8_t id)
+{
+    shellyEMStatus &status = statusSlot(_emStatus, id);
+    if (!isFresh(status, id))
+        EMRefresh(id);
+    return status;
+}
+
+bool shellyEM::EMRefresh(uint8_t id)
+{
+    shellyEMStatus &status = statusSlot(_emStatus, id);
+    shellyJsonScanner json([this, &status](const char* path, const char* value) { EMDecode(status, path, value); });
+    return readStatus(shellyRpc::EMGetStatus, status, id, json);
+}
+
+void shellyEM::EMDecode(shellyEMStatus &status, const char* path, const char* value)
+{
+    // something like {"id":0, ... ,"total_current":0.806,"total_act_power":133.790,"total_aprt_power":240.765, "user_calibrated_phase":[]}
+    if (strcmp(path, "total_current") == 0)
+        status.total_current = atof(value);
+    else if (strcmp(path, "total_act_power") == 0)
+    {
+        status.total_act_power = atof(value);
+        shellySeriesBase* series = statusSlot(_totalActivePowerSeries, status.id);
+        if (series != NULL)
+            series->add(status.total_act_power, millis());
+    }
+    else if (strcmp(path, "total_aprt_power") == 0)
+        status.total_aprt_power = atof(value);
 }
 
-float shellyCover::ActivePower(uint8_t id)
+void shellyEM::decodeShellyStatus(const char* path, const char* value)
 {
-    String response = CoverGetStatus(id);
-    // returns something like {"id":0, "source":"init", "output":false, "apower":0.0, "voltage":231.3, "current":0.000,...}
-    return extractParam(response, "\"apower\":", ',').toFloat();
+    uint8_t id;
+    const char* field = componentField(path, "em", &id);
+    if (field != NULL)
+        EMDecode(markStatus(statusSlot(_emStatus, id), id), field, value);
 }
 
-float shellySwitch::TemperatureDegC(uint8_t id)
+const shellyEM1Status& shellyEM1::EM1Status(uint8_t id)
 {
-    String response = SwitchGetStatus(id);
-    // returns something like {"id":0, ... ,"temperature":{"tC":33.1, "tF":91.6}}
-    return extractParam(response, "\"tC\":", ',').toFloat();
+    shellyEM1Status &status = statusSlot(_em1Status, id);
+    if (!isFresh(status, id))
+        EM1Refresh(id);
+    return status;
 }
 
-float shellySwitch::ActivePower(uint8_t id)
+bool shellyEM1::EM1Refresh(uint8_t id)
 {
-    String response = SwitchGetStatus(id);
-    // returns something like {"id":0, "source":"init", "output":false, "apower":0.0, "voltage":231.3, "current":0.000,...}
-    return extractParam(response, "\"apower\":", ',').toFloat();
+    shellyEM1Status &status = statusSlot(_em1Status, id);
+    shellyJsonScanner json([this, &status](const char* path, const char* value) { EM1Decode(status, path, value); });
+    return readStatus(shellyRpc::EM1GetStatus, status, id, json);
 }
 
-float shellyTemperature::TemperatureDegC(uint8_t id)
+void shellyEM1::EM1Decode(shellyEM1Status &status, const char* path, const char* value)
 {
-    String response = TemperatureGetStatus(id);
-    // returns something like {"id": 0,"tC":27.5, "tF":81.5}
-    return extractParam(response, "\"tC\":", ',').toFloat();
+    // something like {"id":0,"current":0.215,"voltage":231.5,"act_power":23.9,"aprt_power":49.7,"pf":0.48,"freq":50.0,"calibration":"factory"}
+    if (strcmp(path, "current") == 0)
+        status.current = atof(value);
+    else if (strcmp(path, "voltage") == 0)
+        status.voltage = atof(value);
+    else if (strcmp(path, "act_power") == 0)
+        status.act_power = atof(value);
 }
 
-float shellyEM::TotalActivePower(uint8_t id)
+void shellyEM1::decodeShellyStatus(const char* path, const char* value)
 {
-    String response = EMGetStatus(id);
-// return something like {"id":0, ... ,"total_act_power":133.790,"total_aprt_power":240.765, "user_calibrated_phase":[]}
-    return extractParam(response, "\"total_act_power\":", ',').toFloat();
+    uint8_t id;
+    const char* field = componentField(path, "em1", &id);
+    if (field != NULL)
+        EM1Decode(markStatus(statusSlot(_em1Status, id), id), field, value);
 }
@@ -1,11 +1,171 @@
 #ifndef _SHELLYDEVICE_H_
 #define _SHELLYDEVICE_H_
 #include <Arduino.h>
+#include "shellyTransport.h"
+#include "shellyJson.h"
+#include "shellyStats.h"
+#include "shellySeries.h"
 
 // set of classes to access shelly Gen2+ devices via HTTP
 // NOTE: Just some functions from the shelly API are implemented
 // https://shelly-api-docs.shelly.cloud/gen2/
 
+// maximum number of ids cached per component, e.g. switch:0 ... switch:3
+// status of higher ids (e.g. temperature:100) is kept in one additional slot
+#ifndef SHELLY_MAX_ID
+#define SHELLY_MAX_ID 4
+#endif
+
+// timeouts and circuit breaker to fail fast if a device is offline
+// after SHELLY_DOWN_AFTER failed connections a device is marked down, requests
+// fail immediately with SHELLY_ERROR_DOWN. The device is probed by the next request
+// after backoff, which is doubled for each failed probe up to SHELLY_BACKOFF_MAX.
+#ifndef SHELLY_CONNECT_TIMEOUT
+#define SHELLY_CONNECT_TIMEOUT 1500 // default timeout to open connection [ms]
+#endif
+#ifndef SHELLY_READ_TIMEOUT
+#define SHELLY_READ_TIMEOUT 3000    // default timeout waiting for data [ms]
+#endif
+#ifndef SHELLY_DOWN_AFTER
+#define SHELLY_DOWN_AFTER 2         // consecutive failures to mark device down
+#endif
+#ifndef SHELLY_BACKOFF_MIN
+#define SHELLY_BACKOFF_MIN 2000     // first probe of device marked down after [ms]
+#endif
+#ifndef SHELLY_BACKOFF_MAX
+#define SHELLY_BACKOFF_MAX 60000    // maximum interval between probes [ms]
+#endif
+#define SHELLY_ERROR_DOWN (-100)    // response code of requests rejected while device is down
+
+// requests are assembled in stack buffers instead of String objects
+#ifndef SHELLY_URL_LEN
+#define SHELLY_URL_LEN 192   // maximum length of "http://<server>/rpc/<method>?<parameters>"
+#endif
+#ifndef SHELLY_METHOD_LEN
+#define SHELLY_METHOD_LEN 96 // maximum length of method with parameters formatted by GETf()
+#endif
+#define SHELLY_ERROR_URL (-101)     // response code if url does not fit into SHELLY_URL_LEN
+
+// ============================================================================
+// RPC METHODS
+// names of rpc methods used by components, see GETf() to add parameters
+namespace shellyRpc
+{
+    constexpr const char* ShellyGetStatus       = "Shelly.GetStatus";
+    constexpr const char* ShellyGetConfig       = "Shelly.GetConfig";
+    constexpr const char* ShellyListMethods     = "Shelly.ListMethods";
+    constexpr const char* ShellyGetDeviceInfo   = "Shelly.GetDeviceInfo";
+    constexpr const char* ShellyCheckForUpdate  = "Shelly.CheckForUpdate";
+    constexpr const char* ShellyGetComponents   = "Shelly.GetComponents";
+    constexpr const char* WiFiGetConfig         = "WiFi.GetConfig";
+    constexpr const char* WiFiGetStatus         = "WiFi.GetStatus";
+    constexpr const char* InputGetConfig        = "Input.GetConfig";
+    constexpr const char* InputGetStatus        = "Input.GetStatus";
+    constexpr const char* CoverGetConfig        = "Cover.GetConfig";
+    constexpr const char* CoverGetStatus        = "Cover.GetStatus";
+    constexpr const char* CoverOpen             = "Cover.Open";
+    constexpr const char* CoverClose            = "Cover.Close";
+    constexpr const char* CoverStop             = "Cover.Stop";
+    constexpr const char* CoverGoToPosition     = "Cover.GoToPosition";
+    constexpr const char* SwitchSet             = "Switch.Set";
+    constexpr const char* SwitchToggle          = "Switch.Toggle";
+    constexpr const char* SwitchGetConfig       = "Switch.GetConfig";
+    constexpr const char* SwitchGetStatus       = "Switch.GetStatus";
+    constexpr const char* TemperatureGetConfig  = "Temperature.GetConfig";
+    constexpr const char* TemperatureGetStatus  = "Temperature.GetStatus";
+    constexpr const char* EMGetConfig           = "EM.GetConfig";
+    constexpr const char* EMGetStatus           = "EM.GetStatus";
+    constexpr const char* EMDataGetRecords      = "EMData.GetRecords";
+    constexpr const char* EM1GetConfig          = "EM1.GetConfig";
+    constexpr const char* EM1GetStatus          = "EM1.GetStatus";
+    constexpr const char* EM1DataGetRecords     = "EM1Data.GetRecords";
+}
+
+// ============================================================================
+// RESPONSE BUFFER
+// caller supplied fixed size buffer to receive responses without heap allocations
+// data exceeding the buffer is discarded and reported by truncated()
+class shellyBuffer : public Stream
+{
+public:
+    shellyBuffer(char* buffer, size_t size) : _buffer(buffer), _size(size) { clear(); };
+    void clear() { _length = 0; _truncated = false; if (_size > 0) _buffer[0] = 0; };
+    const char* c_str() { return _buffer; };
+    size_t length() { return _length; };
+    bool truncated() { return _truncated; };
+    // Stream interface, data written is appended to buffer (always 0 terminated)
+    size_t write(uint8_t c) override { return write(&c, 1); };
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return 0; };
+    int read() override { return -1; };
+    int peek() override { return -1; };
+private:
+    char* _buffer;
+    size_t _size;
+    size_t _length;
+    bool _truncated;
+};
+
+// ============================================================================
+// STATUS SNAPSHOTS
+// typed status of components read from device, shared by all accessors
+// of the same component and id until statusTTL is expired
+
+// common part of all status snapshots
+struct shellyStatus
+{
+    unsigned long updated = 0; // millis() at last successful read
+    bool valid = false;        // last read successful
+    uint8_t id = 0;            // component id
+};
+
+struct shellyWiFiStatus : shellyStatus
+{
+    int rssi = 0;           // [dB]
+};
+
+struct shellyInputStatus : shellyStatus
+{
+    bool state = false;
+};
+
+struct shellyCoverStatus : shellyStatus
+{
+    float apower = 0;       // active power [W]
+    float voltage = 0;      // [V]
+    float current = 0;      // [A]
+    float tC = 0;           // temperature [degC]
+    int position = 0;       // current_pos [%]
+};
+
+struct shellySwitchStatus : shellyStatus
+{
+    bool output = false;
+    float apower = 0;       // active power [W]
+    float voltage = 0;      // [V]
+    float current = 0;      // [A]
+    float tC = 0;           // temperature [degC]
+};
+
+struct shellyTemperatureStatus : shellyStatus
+{
+    float tC = 0;           // temperature [degC]
+};
+
+struct shellyEMStatus : shellyStatus
+{
+    float total_current = 0;    // [A]
+    float total_act_power = 0;  // [W]
+    float total_aprt_power = 0; // [VA]
+};
+
+struct shellyEM1Status : shellyStatus
+{
+    float act_power = 0;    // active power [W]
+    float voltage = 0;      // [V]
+    float current = 0;      // [A]
+};
+
 // ============================================================================
 // SHELLY COMPONENTS 
 // these classes define functionality which could not be used directly and
@@ -18,38 +178,139 @@
 // additional endpoints like input, switch, cover, energy monitoring
 class shellyDevice
 {
+    friend class shellyWebSocket; // shares authentication and status decoding
+    friend class shellyPipeline;  // shares authentication and circuit breaker
+    friend class shellyBenchmark; // examples/shellyBenchmark.cpp times digest calculation
 protected:
     shellyDevice() {}; // do not allow direct use
 public:
     // set server IP and password in case this device is using authentication
     shellyDevice(String serverIP, String password="") :  
+        name(serverIP),
         _server("http://" + serverIP), 
         _user("admin"), 
-        _password(password),
-        name(serverIP) {};
+        _password(password) { splitServer(); };
+protected:
+    unsigned long _statusTTL = 1000;
+    unsigned long _invalidated = 0; // millis() of last invalidateStatus()
+    bool _invalid = false;          // snapshots read before _invalidated are not fresh
+    bool isFresh(const shellyStatus &status, uint8_t id); // status valid and younger than statusTTL
+    // read and mark status, "?id=<id>" is added to rpcMethod if withId is set
+    bool readStatus(const char* rpcMethod, shellyStatus &status, uint8_t id, shellyJsonScanner &json, bool withId=true);
+    template <class T> T& statusSlot(T* status, uint8_t id) // select cache entry for id
+        { return status[(id < SHELLY_MAX_ID) ? id : SHELLY_MAX_ID]; };
+    template <class T> T& markStatus(T &status, uint8_t id) // mark status as read now
+        { status.id = id; status.valid = true; status.updated = millis(); return status; };
+    // decode value of Shelly.GetStatus response (path like "switch:0.apower") to status of components
+    // to be implemented by components and combined by device classes
+    virtual void decodeShellyStatus(const char* /*path*/, const char* /*value*/) {};
+    // return field path after "component:id." (or "component." if id is NULL), NULL if path does not match
+    static const char* componentField(const char* path, const char* component, uint8_t* id);
+public:
     String name; // could be used by user to identify device. Set to serverIP as default by constructor
     String server() { return _server; }; // return full server IP string
     String extractParam(String s, String param, char delimiter); // extract part between param and delimiter
     // do HTTP GET command access respective method in /rpc tree of web interface
-    String GET(String rpcMethod);   // function adds "/rpc/" to method passed
+    String GET(const char* rpcMethod);  // function adds "/rpc/" to method passed
+    int GET(const char* rpcMethod, String &payload); // same, but returns HTTP response code
+    int GET(const char* rpcMethod, Stream &stream);  // write response to stream, e.g. shellyJsonScanner
+    // write response to caller supplied buffer (0 terminated), returns HTTP response code
+    // truncated is set if response did not fit into buffer, buffer is empty on errors
+    int GET(const char* rpcMethod, char* buffer, size_t size, bool* truncated=NULL);
+    // same for method passed as String
+    String GET(const String &rpcMethod) 
+        { return GET(rpcMethod.c_str()); };
+    int GET(const String &rpcMethod, String &payload)
+        { return GET(rpcMethod.c_str(), payload); };
+    int GET(const String &rpcMethod, Stream &stream)
+        { return GET(rpcMethod.c_str(), stream); };
+    int GET(const String &rpcMethod, char* buffer, size_t size, bool* truncated=NULL)
+        { return GET(rpcMethod.c_str(), buffer, size, truncated); };
+    // method and parameters formatted like printf, e.g. GETf("%s?id=%u", shellyRpc::SwitchToggle, id)
+    String GETf(const char* format, ...);
     // common functions for all Gen2+ devices
     String shellyGetStatus()       
-        { return GET("shelly.GetStatus"); };
+        { return GET(shellyRpc::ShellyGetStatus); };
     String shellyGetConfig()
-        { return GET("shelly.GetConfig"); };
+        { return GET(shellyRpc::ShellyGetConfig); };
     String shellyListMethods()
-        { return GET("shelly.ListMethods"); };
+        { return GET(shellyRpc::ShellyListMethods); };
     String shellyGetDeviceInfo()
-        { return GET("shelly.GetDeviceInfo"); };
+        { return GET(shellyRpc::ShellyGetDeviceInfo); };
     String shellyCheckForUpdate()
-        { return GET("shelly.CheckForUpdate"); };
+        { return GET(shellyRpc::ShellyCheckForUpdate); };
     String shellyGetComponents()
-        { return GET("shelly.GetComponents"); };
+        { return GET(shellyRpc::ShellyGetComponents); };
+    // read status of all components using a single shelly.GetStatus request
+    bool refresh();
+    // persistent HTTP/1.1 connection, closed if idle for more than idleTimeout [ms]
+    // idleTimeout = 0 closes connection after each request
+    void setKeepAlive(unsigned long idleTimeout) { _keepAlive = idleTimeout; };
+    void closeIdleConnection(); // could be called from loop() to release idle connection
+    void disconnect();          // close connection, will reconnect on next request
+    // timeouts to open connection and to wait for response data [ms]
+    void setTimeouts(unsigned long connectTimeout, unsigned long readTimeout)
+        { _connectTimeout = connectTimeout; _readTimeout = readTimeout; };
+    bool down() { return _backoff > 0; }; // device marked down, requests fail immediately until probe is due
+    // status snapshots used by typed accessors like ActivePower() are reused
+    // for ttl [ms] before reading again, ttl = 0 reads with each call
+    void setStatusTTL(unsigned long ttl) { _statusTTL = ttl; };
+    void invalidateStatus(); // read all snapshots again on next access, e.g. if pushed updates stopped
+    // authentication statistics
+    unsigned long authChallenges() { return _authChallenges; }; // 401 challenges answered
+    unsigned long authAvoided() { return _authAvoided; };       // requests accepted with cached nonce
+#if SHELLY_STATS
+    // request statistics and latency histograms, see shellyStats.h
+    const shellyStats& stats() { return _stats; };
+    void printStats(Print &out) { _stats.print(out); }; // write statistics as JSON
+    void resetStats() { _stats.clear(); };
+#endif
 private:
     String _server;
+    String _host;                   // of _server without port, to open connections
+    uint16_t _port = 80;            // of _server
     String _user;
     String _password;
-    String SHA256hash(String s);    // calculate SHA256 hash for string s
+    WiFiClient _wifi;               // kept open between requests
+    HTTPClient _http;
+    unsigned long _keepAlive = 5000; // idle timeout [ms]
+    unsigned long _lastRequest = 0; // millis() at end of last request
+    unsigned long _connectTimeout = SHELLY_CONNECT_TIMEOUT;
+    unsigned long _readTimeout = SHELLY_READ_TIMEOUT;
+    uint8_t _failures = 0;          // consecutive failed requests
+    unsigned long _backoff = 0;     // interval between probes if device is down [ms], 0 if up
+    void checkHealth(int httpResponseCode); // update circuit breaker
+    bool rejected();                // device down and probe not due yet, request fails fast
+    void splitServer();             // set _host and _port from _server
+    const char* hostHeader() { return _server.c_str() + 7; }; // "host" or "host:port" without http://
+    bool connect(WiFiClient &client); // open new connection to server with client
+    bool connect();                 // same for connection of GET requests
+    int sendGET(const char* uri, const char* authString); // send single GET request for "/rpc/..."
+    int request(const char* rpcMethod); // send request, answer authentication challenge
+    void finishRequest(int httpResponseCode, const char* rpcMethod); // end request, keep connection if possible
+#if SHELLY_STATS
+    shellyStats _stats;
+    unsigned long _requestStart = 0; // micros() at start of current request
+    unsigned long _sendTime = 0;     // duration of last sendGET until response header received [us]
+    void parsed(shellyJsonScanner &json); // account time spent decoding a response
+#endif
+    // digest authentication state cached from last challenge
+    // used to send Authorization header with first request
+    // fixed size buffers to avoid heap allocations for each request
+    char _realm[48] = "";
+    char _nonce[24] = "";
+    char _qop[16] = "";
+    char _algo[16] = "";
+    char _HA1[65] = "";             // SHA256(user:realm:password) as hex, recalculated if realm changes
+    unsigned long _nc = 0;          // nonce count, incremented with each request
+    unsigned long _authChallenges = 0;
+    unsigned long _authAvoided = 0;
+    void setRealm(const char* realm);   // store realm and calculate HA1
+    void digestResponse(const char* method, const char* uri, // calculate digest response as hex
+        const char* nonce, const char* nc, const char* cnonce, const char* qop, char* response);
+    void parseChallenge(const char* AuthHeader); // store realm, nonce, ... from WWW-Authenticate header
+    // Authorization header for request to uri using cached nonce
+    const char* authorization(const char* uri, char* buffer, size_t size, const char* httpMethod="GET");
 };
 
 // shelly wifi, should be available in all components using this library
@@ -60,10 +321,17 @@ protected:
     shellyWiFi() {}; // do not allow direct use of this class
 public:
     String WiFiGetConfig()
-        { return GET("WiFi.GetConfig"); };
+        { return GET(shellyRpc::WiFiGetConfig); };
     String WiFiGetStatus()
-        { return GET("WiFi.GetStatus"); };
-    int WiFiRSSI();
+        { return GET(shellyRpc::WiFiGetStatus); };
+    const shellyWiFiStatus& WiFiStatus(); // cached status, read if older than statusTTL
+    bool WiFiRefresh();                   // force reading status
+    int WiFiRSSI()
+        { return WiFiStatus().rssi; };
+protected:
+    shellyWiFiStatus _wifiStatus;
+    void WiFiDecode(shellyWiFiStatus &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // shelly inputs, e.g. available in ShellyPlus1PM, ShellyPlus2PM
@@ -74,9 +342,17 @@ protected:
     shellyInput() {}; // do not allow direct use of this class
 public:
     String InputGetConfig(uint8_t id=0)
-        { return GET("Input.GetConfig?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::InputGetConfig, id); };
     String InputGetStatus(uint8_t id=0)
-        { return GET("Input.GetStatus?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::InputGetStatus, id); };
+    const shellyInputStatus& InputStatus(uint8_t id=0); // cached status, read if older than statusTTL
+    bool InputRefresh(uint8_t id=0);                    // force reading status
+    bool InputState(uint8_t id=0)
+        { return InputStatus(id).state; };
+protected:
+    shellyInputStatus _inputStatus[SHELLY_MAX_ID+1];
+    void InputDecode(shellyInputStatus &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // shelly cover, e.g. available in ShellyPlus2PM
@@ -87,19 +363,33 @@ protected:
     shellyCover() {}; // do not allow direct use of this class
 public:
     String CoverGetConfig(uint8_t id=0)
-        { return GET("Cover.GetConfig?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::CoverGetConfig, id); };
     String CoverGetStatus(uint8_t id=0)
-        { return GET("Cover.GetStatus?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::CoverGetStatus, id); };
     String CoverOpen(uint8_t id=0)
-        { return GET("Cover.Open?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::CoverOpen, id); };
     String CoverClose(uint8_t id=0)
-        { return GET("Cover.Close?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::CoverClose, id); };
     String CoverStop(uint8_t id=0)
-        { return GET("Cover.Stop?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::CoverStop, id); };
     String CoverGoToPosition(uint8_t pos=100, uint8_t id=0)
-        { return GET("Cover.GoToPosition?id=" + String(id) + "&pos=" + String(pos)); };
-    float TemperatureDegC(uint8_t id=0);
-    float ActivePower(uint8_t id=0);
+        { return GETf("%s?id=%u&pos=%u", shellyRpc::CoverGoToPosition, id, pos); };
+    const shellyCoverStatus& CoverStatus(uint8_t id=0); // cached status, read if older than statusTTL
+    bool CoverRefresh(uint8_t id=0);                    // force reading status
+    float TemperatureDegC(uint8_t id=0)
+        { return CoverStatus(id).tC; };
+    float ActivePower(uint8_t id=0)
+        { return CoverStatus(id).apower; };
+    float Voltage(uint8_t id=0)
+        { return CoverStatus(id).voltage; };
+    float Current(uint8_t id=0)
+        { return CoverStatus(id).current; };
+    int Position(uint8_t id=0)
+        { return CoverStatus(id).position; };
+protected:
+    shellyCoverStatus _coverStatus[SHELLY_MAX_ID+1];
+    void CoverDecode(shellyCoverStatus &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // shelly switch, e.g. available in ShellyPlus1PM, SHellyPlus2PM
@@ -110,15 +400,33 @@ protected:
     shellySwitch() {}; // do not allow direct use of this class
 public:
     String SwitchSet(bool on, uint8_t id=0)
-        { return GET("Switch.Set?id=" + String(id) + "&on=" + on ? "true":"false"); };
+        { return GETf("%s?id=%u&on=%s", shellyRpc::SwitchSet, id, on ? "true" : "false"); };
     String SwitchToggle(uint8_t id=0)
-        { return GET("Switch.Toggle?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::SwitchToggle, id); };
     String SwitchGetConfig(uint8_t id=0)
-        { return GET("Switch.GetConfig?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::SwitchGetConfig, id); };
     String SwitchGetStatus(uint8_t id=0)
-        { return GET("Switch.GetStatus?id=" + String(id)); };
-    float TemperatureDegC(uint8_t id=0);
-    float ActivePower(uint8_t id=0);
+        { return GETf("%s?id=%u", shellyRpc::SwitchGetStatus, id); };
+    const shellySwitchStatus& SwitchStatus(uint8_t id=0); // cached status, read if older than statusTTL
+    bool SwitchRefresh(uint8_t id=0);                     // force reading status
+    float TemperatureDegC(uint8_t id=0)
+        { return SwitchStatus(id).tC; };
+    float ActivePower(uint8_t id=0)
+        { return SwitchStatus(id).apower; };
+    float Voltage(uint8_t id=0)
+        { return SwitchStatus(id).voltage; };
+    float Current(uint8_t id=0)
+        { return SwitchStatus(id).current; };
+    bool Output(uint8_t id=0)
+        { return SwitchStatus(id).output; };
+    // add each active power reading received to series (see shellySeries.h), NULL to stop
+    void recordActivePower(shellySeriesBase* series, uint8_t id=0)
+        { statusSlot(_activePowerSeries, id) = series; };
+protected:
+    shellySwitchStatus _switchStatus[SHELLY_MAX_ID+1];
+    shellySeriesBase* _activePowerSeries[SHELLY_MAX_ID+1] = {};
+    void SwitchDecode(shellySwitchStatus &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // temperature sensors, available e.g. in ShellyPro3EM
@@ -129,10 +437,17 @@ protected:
     shellyTemperature() {}; // do not allow direct use of this class
 public:
     String TemperatureGetConfig(uint8_t id=0)
-        { return GET("Temperature.GetConfig?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::TemperatureGetConfig, id); };
     String TemperatureGetStatus(uint8_t id=0)
-        { return GET("Temperature.GetStatus?id=" + String(id)); };
-    float TemperatureDegC(uint8_t id=0);
+        { return GETf("%s?id=%u", shellyRpc::TemperatureGetStatus, id); };
+    const shellyTemperatureStatus& TemperatureStatus(uint8_t id=0); // cached status, read if older than statusTTL
+    bool TemperatureRefresh(uint8_t id=0);                          // force reading status
+    float TemperatureDegC(uint8_t id=0)
+        { return TemperatureStatus(id).tC; };
+protected:
+    shellyTemperatureStatus _temperatureStatus[SHELLY_MAX_ID+1];
+    void TemperatureDecode(shellyTemperatureStatus &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // multiple phase totalized energy monitoring, e.g. available in ShellyPro3EM in three phase mode
@@ -143,10 +458,27 @@ protected:
     shellyEM() {}; // do not allow direct use of this class
 public:
     String EMGetConfig(uint8_t id=0)
-        { return GET("EM.GetConfig?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::EMGetConfig, id); };
     String EMGetStatus(uint8_t id=0) // e.g. ShellyPro3EM
-        { return GET("EM.GetStatus?id=" + String(id)); };
-    float TotalActivePower(uint8_t id=0);
+        { return GETf("%s?id=%u", shellyRpc::EMGetStatus, id); };
+    String EMDataGetRecords(uint8_t id=0, unsigned long ts=0) // energy history stored, see shellyEMData to import
+        { return GETf("%s?id=%u&ts=%lu", shellyRpc::EMDataGetRecords, id, ts); };
+    const shellyEMStatus& EMStatus(uint8_t id=0); // cached status, read if older than statusTTL
+    bool EMRefresh(uint8_t id=0);                 // force reading status
+    float TotalActivePower(uint8_t id=0)
+        { return EMStatus(id).total_act_power; };
+    float TotalApparentPower(uint8_t id=0)
+        { return EMStatus(id).total_aprt_power; };
+    float TotalCurrent(uint8_t id=0)
+        { return EMStatus(id).total_current; };
+    // add each total active power reading received to series (see shellySeries.h), NULL to stop
+    void recordTotalActivePower(shellySeriesBase* series, uint8_t id=0)
+        { statusSlot(_totalActivePowerSeries, id) = series; };
+protected:
+    shellyEMStatus _emStatus[SHELLY_MAX_ID+1];
+    shellySeriesBase* _totalActivePowerSeries[SHELLY_MAX_ID+1] = {};
+    void EMDecode(shellyEMStatus &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // single phase energy monitoring, e.g. available 3 times in ShellyPro3EM if in monophase mode
@@ -157,9 +489,23 @@ protected:
     shellyEM1() {}; // do not allow direct use of this class
 public:
     String EM1GetConfig(uint8_t id=0)
-        { return GET("EM1.GetConfig?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::EM1GetConfig, id); };
     String EM1GetStatus(uint8_t id=0)
-        { return GET("EM1.GetStatus?id=" + String(id)); };
+        { return GETf("%s?id=%u", shellyRpc::EM1GetStatus, id); };
+    String EM1DataGetRecords(uint8_t id=0, unsigned long ts=0) // energy history stored, see shellyEMData to import
+        { return GETf("%s?id=%u&ts=%lu", shellyRpc::EM1DataGetRecords, id, ts); };
+    const shellyEM1Status& EM1Status(uint8_t id=0); // cached status, read if older than statusTTL
+    bool EM1Refresh(uint8_t id=0);                  // force reading status
+    float EM1ActivePower(uint8_t id=0)
+        { return EM1Status(id).act_power; };
+    float EM1Voltage(uint8_t id=0)
+        { return EM1Status(id).voltage; };
+    float EM1Current(uint8_t id=0)
+        { return EM1Status(id).current; };
+protected:
+    shellyEM1Status _em1Status[SHELLY_MAX_ID+1];
+    void EM1Decode(shellyEM1Status &status, const char* path, const char* value);
+    void decodeShellyStatus(const char* path, const char* value) override;
 };
 
 // ============================================================================
@@ -185,6 +531,9 @@ class ShellyPlus1PM : public shellyWiFi, public shellyInput, public shellySwitch
 public:
     ShellyPlus1PM(String serverIP, String password="") :
         shellyDevice(serverIP, password) {};
+protected:
+    void decodeShellyStatus(const char* path, const char* value) override
+        { shellyWiFi::decodeShellyStatus(path, value); shellyInput::decodeShellyStatus(path, value); shellySwitch::decodeShellyStatus(path, value); };
 };
 
 // ShellyPlus2PM in cover profile (two interlocked outputs, two inputs for open/close)
@@ -194,6 +543,9 @@ class ShellyPlus2PMcover : public shellyWiFi, public shellyCover, public shellyI
 public:
     ShellyPlus2PMcover(String serverIP, String password="") :
         shellyDevice(serverIP, password) {};
+protected:
+    void decodeShellyStatus(const char* path, const char* value) override
+        { shellyWiFi::decodeShellyStatus(path, value); shellyCover::decodeShellyStatus(path, value); shellyInput::decodeShellyStatus(path, value); };
 };
 
 // ShellyPlus2PM in switch profile (two independend switches, two inputs to control)
@@ -203,6 +555,9 @@ class ShellyPlus2PMswitch : public shellyWiFi, public shellySwitch, public shell
 public:
     ShellyPlus2PMswitch(String serverIP, String password="") :
         shellyDevice(serverIP, password) {};
+protected:
+    void decodeShellyStatus(const char* path, const char* value) override
+        { shellyWiFi::decodeShellyStatus(path, value); shellySwitch::decodeShellyStatus(path, value); shellyInput::decodeShellyStatus(path, value); };
 };
 
 // ShellyPlugPlusS (wifi plug adapter)
@@ -212,6 +567,9 @@ class ShellyPlugPlusS : public shellyWiFi, public shellySwitch
 public:
     ShellyPlugPlusS(String serverIP, String password="") :
         shellyDevice(serverIP, password) {};
+protected:
+    void decodeShellyStatus(const char* path, const char* value) override
+        { shellyWiFi::decodeShellyStatus(path, value); shellySwitch::decodeShellyStatus(path, value); };
 };
 
 // ShellyPro3EM (three phase energy monitoring)
@@ -221,6 +579,9 @@ class ShellyPro3EM3phase : public shellyWiFi, public shellyEM, public shellyTemp
 public:
     ShellyPro3EM3phase(String serverIP, String password="") :
         shellyDevice(serverIP, password) {};
+protected:
+    void decodeShellyStatus(const char* path, const char* value) override
+        { shellyWiFi::decodeShellyStatus(path, value); shellyEM::decodeShellyStatus(path, value); shellyTemperature::decodeShellyStatus(path, value); };
 };
 
 // ShellyPro3EM (used as three independent phase monitoring systems)
@@ -230,6 +591,9 @@ class ShellyPro3EMmono : public shellyWiFi, public shellyEM, public shellyEM1, p
 public:
     ShellyPro3EMmono(String serverIP, String password="") :
         shellyDevice(serverIP, password) {};
+protected:
+    void decodeShellyStatus(const char* path, const char* value) override
+        { shellyWiFi::decodeShellyStatus(path, value); shellyEM::decodeShellyStatus(path, value); shellyEM1::decodeShellyStatus(path, value); shellyTemperature::decodeShellyStatus(path, value); };
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "shellyEMData.h"
+
+shellyEMData::shellyEMData(shellyDevice &device, const char* component, uint8_t id) :
+    _device(device),
+    _component(component),
+    _id(id),
+    _json([this](const char* path, const char* value) { decode(path, value); })
+{
+}
+
+unsigned long shellyEMData::firstTimestamp()
+{
+    // something like {"data_blocks":[{"ts":1656356400,"period":60,"records":5640}, ...]}
+    unsigned long first = 0;
+    shellyJsonScanner json([&first](const char* path, const char* value) {
+        if (strcmp(path, "data_blocks[].ts") == 0)
+        {
+            unsigned long ts = strtoul(value, NULL, 10);
+            if ((first == 0) || (ts < first))
+                first = ts;
+        }
+    });
+    char method[SHELLY_METHOD_LEN];
+    snprintf(method, sizeof(method), "%s.GetRecords?id=%u&ts=0", _component, _id);
+    if (_device.GET(method, json) != HTTP_CODE_OK)
+        return 0;
+    return first;
+}
+
+void shellyEMData::begin(unsigned long ts, unsigned long endTs)
+{
+    _ts = ts;
+    _endTs = endTs;
+    _rows = 0;
+    _done = false;
+}
+
+int shellyEMData::fetch()
+{
+    if (_done)
+        return HTTP_CODE_OK;
+    char method[SHELLY_METHOD_LEN];
+    int len = snprintf(method, sizeof(method), "%s.GetData?id=%u&ts=%lu", _component, _id, _ts);
+    if (_endTs > 0)
+        snprintf(method + len, sizeof(method) - len, "&end_ts=%lu", _endTs);
+    _keyCount = 0;
+    _keyTotal = 0;
+    _column = 0;
+    _nextRecord = 0;
+    unsigned long lastRow = _rows;
+    _json.reset();
+    int httpResponseCode = _device.GET(method, _json);
+    if (httpResponseCode != HTTP_CODE_OK)
+        return httpResponseCode; // page could be read again, rows already passed are repeated
+    if ((_nextRecord > _ts) && ((_endTs == 0) || (_nextRecord < _endTs)))
+        _ts = _nextRecord; // more records available
+    else
+    {
+        if (_rows > lastRow) // continue after last record when resuming later
+            _ts = _blockTs + _blockRow * _period;
+        _done = true;
+    }
+    return httpResponseCode;
+}
+
+int shellyEMData::keyIndex(const char* name)
+{
+    for (uint8_t i=0; i<_keyCount; i++)
+        if (strcmp(_keys[i], name) == 0)
+            return i;
+    return -1;
+}
+
+void shellyEMData::decode(const char* path, const char* value)
+{
+    // something like {"keys":["a_total_act_energy", ... ],
+    //   "data":[{"ts":1656356400,"period":60,"values":[[0.5, ... ],[0.6, ... ], ... ]}, ... ],
+    //   "next_record_ts":1656357000}
+    // ts and period of a data block are expected before its values
+    if (strcmp(path, "data[].values[][]") == 0)
+    {
+        if (_column < SHELLY_EMDATA_KEYS)
+            _values[_column] = (strcmp(value, "null") == 0) ? NAN : atof(value);
+        if (++_column >= _keyTotal) // row complete
+        {
+            if (_onRow)
+                _onRow(_blockTs + _blockRow * _period, _values, _keyCount);
+            _rows++;
+            _blockRow++;
+            _column = 0;
+        }
+    }
+    else if (strcmp(path, "keys[]") == 0)
+    {
+        if (_keyCount < SHELLY_EMDATA_KEYS)
+        {
+            strncpy(_keys[_keyCount], value, SHELLY_EMDATA_KEY_LEN-1);
+            _keys[_keyCount][SHELLY_EMDATA_KEY_LEN-1] = 0;
+            _keyCount++;
+        }
+        _keyTotal++;
+    }
+    else if (strcmp(path, "data[].ts") == 0)
+    {
+        _blockTs = strtoul(value, NULL, 10);
+        _blockRow = 0;
+        _column = 0;
+    }
+    else if (strcmp(path, "data[].period") == 0)
+        _period = strtoul(value, NULL, 10);
+    else if (strcmp(path, "next_record_ts") == 0)
+        _nextRecord = strtoul(value, NULL, 10);
+}
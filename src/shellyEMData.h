@@ -0,0 +1,68 @@
+#ifndef _SHELLYEMDATA_H_
+#define _SHELLYEMDATA_H_
+#include <Arduino.h>
+#include <functional>
+#include "shellyDevice.h"
+#include "shellyJson.h"
+
+// import of energy history stored by energy meters like ShellyPro3EM
+// https://shelly-api-docs.shelly.cloud/gen2/ComponentsAndServices/EMData
+// https://shelly-api-docs.shelly.cloud/gen2/ComponentsAndServices/EM1Data
+// Records (one per minute) are read page by page using <component>.GetData,
+// each page continues at the timestamp of the next record reported by the
+// device. Rows are decoded while receiving and passed to the callback, so
+// memory used is constant no matter how many records are imported.
+//   shellyEMData history(gridSupply);              // EMData of ShellyPro3EM3phase
+//   shellyEMData history(phases, "EM1Data", 1);    // EM1Data of ShellyPro3EMmono phase B
+// NOTE: save nextTimestamp() to resume import later, e.g. after restart
+
+#ifndef SHELLY_EMDATA_KEYS
+#define SHELLY_EMDATA_KEYS 64 // maximum number of values per record, further values are skipped
+#endif
+#ifndef SHELLY_EMDATA_KEY_LEN
+#define SHELLY_EMDATA_KEY_LEN 24 // maximum length of key names including terminating 0
+#endif
+
+class shellyEMData
+{
+public:
+    // ts is unix time of record, values[i] belongs to key(i), NAN if not available
+    typedef std::function<void(unsigned long ts, const float* values, uint8_t count)> rowCallback;
+    shellyEMData(shellyDevice &device, const char* component="EMData", uint8_t id=0);
+    void onRow(rowCallback cb) { _onRow = cb; };
+    unsigned long firstTimestamp(); // oldest record stored on device using GetRecords, 0 on error
+    // import records from ts up to endTs (0 for all available records)
+    void begin(unsigned long ts, unsigned long endTs=0);
+    int fetch();                    // read next page, returns HTTP response code
+    bool done() { return _done; };  // all records up to endTs have been read
+    unsigned long nextTimestamp() { return _ts; }; // first record of next page
+    unsigned long rows() { return _rows; };        // rows passed to callback since begin()
+    // names of values, e.g. "a_total_act_energy", available after first page has been read
+    uint8_t keys() { return _keyCount; };
+    const char* key(uint8_t i) { return (i < _keyCount) ? _keys[i] : ""; };
+    int keyIndex(const char* name); // index of key in values, -1 if not found
+private:
+    shellyDevice &_device;
+    const char* _component;         // "EMData" or "EM1Data"
+    uint8_t _id;
+    rowCallback _onRow;
+    shellyJsonScanner _json;
+    unsigned long _ts = 0;          // start of next page
+    unsigned long _endTs = 0;
+    bool _done = true;
+    unsigned long _rows = 0;
+    // keys of current response
+    char _keys[SHELLY_EMDATA_KEYS][SHELLY_EMDATA_KEY_LEN];
+    uint8_t _keyCount = 0;
+    uint16_t _keyTotal = 0;         // keys in response including skipped ones
+    // decoding current page
+    unsigned long _blockTs = 0;     // timestamp of first row of data block
+    unsigned long _period = 60;     // [s] between rows of block
+    unsigned long _blockRow = 0;    // row within block
+    uint16_t _column = 0;           // value within row
+    unsigned long _nextRecord = 0;  // next_record_ts of response, 0 if complete
+    float _values[SHELLY_EMDATA_KEYS];
+    void decode(const char* path, const char* value);
+};
+
+#endif
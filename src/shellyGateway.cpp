@@ -0,0 +1,213 @@
+#include "shellyGateway.h"
+
+bool shellyGateway::add(shellyDevice &device, const char* name)
+{
+    if (_numDevices >= SHELLY_GATEWAY_DEVICES)
+        return false;
+    if (!_poller.add(device, shellyRpc::ShellyGetStatus))
+        return false;
+    _devices[_numDevices] = &device;
+    _names[_numDevices] = name;
+    _numDevices++;
+    return true;
+}
+
+bool shellyGateway::allow(const char* pattern)
+{
+    if (_numAllowed >= SHELLY_GATEWAY_ALLOWED)
+        return false;
+    _allowed[_numAllowed++] = pattern;
+    return true;
+}
+
+bool shellyGateway::allowed(const String &method)
+{
+    for (uint8_t i=0; i<_numAllowed; i++)
+        if (match(_allowed[i], method.c_str()))
+            return true;
+    return false;
+}
+
+// '*' matches any (also no) characters, e.g. "*.GetStatus" matches "Switch.GetStatus"
+bool shellyGateway::match(const char* pattern, const char* method)
+{
+    if (*pattern == '*')
+        return match(pattern+1, method) || ((*method != 0) && match(pattern, method+1));
+    if (*pattern != *method)
+        return false;
+    return (*pattern == 0) || match(pattern+1, method+1);
+}
+
+// arguments are decoded by WebServer, encode them again to forward
+String shellyGateway::urlEncode(const String &text)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    String encoded;
+    encoded.reserve(text.length());
+    for (unsigned int i=0; i<text.length(); i++)
+    {
+        char c = text[i];
+        if (isalnum((unsigned char)c) || (c == '-') || (c == '_') || (c == '.') || (c == '~'))
+            encoded += c;
+        else
+        {
+            encoded += '%';
+            encoded += hex[(c >> 4) & 0x0F];
+            encoded += hex[c & 0x0F];
+        }
+    }
+    return encoded;
+}
+
+void shellyGateway::begin()
+{
+    _server.on("/status", HTTP_GET, [this]() { handleStatus(); });
+    _server.onNotFound([this]() { handleRpc(); });
+    _poller.onResult([this](const shellyPollJob &job) {
+        for (uint8_t i=0; i<_numDevices; i++)
+            if ((_devices[i] == job.device) && (job.httpResponseCode / 100 == 2))
+                store(i, job.rpcMethod, job.httpResponseCode, job.payload);
+    });
+    _server.begin();
+}
+
+void shellyGateway::handle()
+{
+    _server.handleClient();
+}
+
+shellyGatewayEntry* shellyGateway::lookup(uint8_t device, const String &method)
+{
+    for (uint8_t i=0; i<SHELLY_GATEWAY_CACHE; i++)
+    {
+        shellyGatewayEntry &entry = _cache[i];
+        if ((entry.device == device) && (millis() - entry.fetched < _ttl) && (entry.method == method))
+            return &entry;
+    }
+    return NULL;
+}
+
+// store response in entry of same request, unused or oldest entry
+shellyGatewayEntry& shellyGateway::store(uint8_t device, const String &method, int httpResponseCode, const String &payload)
+{
+    shellyGatewayEntry* slot = NULL;
+    for (uint8_t i=0; (i<SHELLY_GATEWAY_CACHE) && (slot == NULL); i++)
+        if ((_cache[i].device == device) && (_cache[i].method == method))
+            slot = &_cache[i];
+    for (uint8_t i=0; (i<SHELLY_GATEWAY_CACHE) && (slot == NULL); i++)
+        if (_cache[i].device < 0)
+            slot = &_cache[i];
+    if (slot == NULL)
+    {
+        slot = &_cache[0];
+        for (uint8_t i=1; i<SHELLY_GATEWAY_CACHE; i++)
+            if ((long)(_cache[i].fetched - slot->fetched) < 0)
+                slot = &_cache[i];
+    }
+    slot->device = device;
+    slot->method = method;
+    slot->payload = payload;
+    slot->httpResponseCode = httpResponseCode;
+    slot->fetched = millis();
+    return *slot;
+}
+
+void shellyGateway::invalidate(uint8_t device)
+{
+    for (uint8_t i=0; i<SHELLY_GATEWAY_CACHE; i++)
+        if (_cache[i].device == device)
+            _cache[i].device = -1;
+}
+
+void shellyGateway::send(int httpResponseCode, const String &payload)
+{
+    if (httpResponseCode > 0)
+        _server.send(httpResponseCode, "application/json", payload);
+    else // no response from device
+        _server.send(502, "application/json", payload);
+}
+
+void shellyGateway::handleRpc()
+{
+    // uri like /plug1/rpc/Switch.GetStatus, parameters are passed as arguments
+    String uri = _server.uri();
+    int rpc = uri.indexOf("/rpc/");
+    String name = (rpc > 0) ? uri.substring(1, rpc) : String();
+    int8_t device = -1;
+    for (uint8_t i=0; i<_numDevices; i++)
+        if (name == _names[i])
+            device = i;
+    if (device < 0)
+    {
+        _server.send(404, "application/json", "{\"code\":404, \"message\":\"unknown device\"}");
+        return;
+    }
+    String method = uri.substring(rpc + 5);
+    if (!allowed(method))
+    {
+        _server.send(403, "application/json", "{\"code\":403, \"message\":\"method not allowed\"}");
+        return;
+    }
+    bool first = true;
+    for (int i=0; i<_server.args(); i++)
+    {
+        if (_server.argName(i) == "plain") // body of POST request
+            continue;
+        method += String(first ? "?" : "&") + urlEncode(_server.argName(i)) + "=" + urlEncode(_server.arg(i));
+        first = false;
+    }
+
+    // only responses of Get methods are cached, others may change state of device
+    bool cacheable = method.indexOf(".Get") > 0;
+    if (cacheable)
+    {
+        shellyGatewayEntry* entry = lookup(device, method);
+        if (entry != NULL)
+        {
+            _hits++;
+            send(entry->httpResponseCode, entry->payload);
+            return;
+        }
+    }
+    String payload;
+    int httpResponseCode = _devices[device]->GET(method, payload);
+    _upstream++;
+    if (!cacheable)
+        invalidate(device);
+    else if (httpResponseCode / 100 == 2) // errors would be served for ttl
+        store(device, method, httpResponseCode, payload);
+    send(httpResponseCode, payload);
+}
+
+void shellyGateway::handleStatus()
+{
+    // read all devices concurrently unless all status documents are cached
+    bool cached = true;
+    for (uint8_t i=0; i<_numDevices; i++)
+        cached &= (lookup(i, shellyRpc::ShellyGetStatus) != NULL);
+    if (cached)
+        _hits++;
+    else if (_poller.start())
+    {
+        while (_poller.running())
+        {
+            _poller.handle(); // results are stored to cache by callback
+            delay(1);
+        }
+        _upstream += _numDevices;
+    }
+
+    // {"plug1":{...},"grid":{...}}, devices not available as {"httpResponse": code}
+    // jobs of poller are in order of devices
+    _server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    _server.send(200, "application/json", "");
+    for (uint8_t i=0; i<_numDevices; i++)
+    {
+        shellyGatewayEntry* entry = lookup(i, shellyRpc::ShellyGetStatus);
+        _server.sendContent(String(i == 0 ? "{\"" : ",\"") + _names[i] + "\":");
+        _server.sendContent((entry != NULL) ? entry->payload :
+            String("{\"httpResponse\": ") + String(_poller.job(i).httpResponseCode) + "}");
+    }
+    _server.sendContent(_numDevices ? "}" : "{}");
+    _server.sendContent(""); // end of chunked response
+}
@@ -0,0 +1,82 @@
+#ifndef _SHELLYGATEWAY_H_
+#define _SHELLYGATEWAY_H_
+#include <Arduino.h>
+#include <WebServer.h>
+#include "shellyDevice.h"
+#include "shellyPoller.h"
+
+// local HTTP endpoint serving state of shelly devices to many clients
+// Requests to http://<esp>/<name>/rpc/<method>?<parameters> are forwarded to the
+// device registered as name. Responses of Get methods (e.g. Switch.GetStatus)
+// are cached for ttl, so any number of clients costs about one request to
+// the device per ttl. Other methods (e.g. Switch.Set) are always forwarded and
+// clear the cache of the device. Error responses are not cached.
+// Only methods matching the allowlist are forwarded, others are answered with 403.
+// By default these are *.GetStatus and *.GetConfig, add others with allow().
+//   gateway.allow("Switch.Set");    // '*' matches any characters, e.g. "Switch.*"
+// http://<esp>/status returns Shelly.GetStatus of all devices as one document
+// {"<name>":{...}, ...}, devices are read concurrently by a shellyPoller.
+// NOTE: requests are served one after another from handle(), identical
+// requests arriving while one is forwarded are answered from the cache
+// NOTE: do not access registered devices from other tasks while handle() is running
+// NOTE: the gateway does not authenticate clients, requests are sent to the devices with
+// their stored passwords, so any local client may call the methods allowed
+
+#ifndef SHELLY_GATEWAY_DEVICES
+#define SHELLY_GATEWAY_DEVICES 8  // maximum number of devices
+#endif
+#ifndef SHELLY_GATEWAY_CACHE
+#define SHELLY_GATEWAY_CACHE 16   // number of responses cached
+#endif
+#ifndef SHELLY_GATEWAY_ALLOWED
+#define SHELLY_GATEWAY_ALLOWED 8  // maximum number of method patterns allowed
+#endif
+
+// cached response of a device
+struct shellyGatewayEntry
+{
+    int8_t device = -1;             // index of device, -1 if unused
+    String method;                  // method including parameters
+    String payload;
+    int httpResponseCode = 0;
+    unsigned long fetched = 0;      // millis() of response
+};
+
+class shellyGateway
+{
+public:
+    shellyGateway(uint16_t port=80, unsigned long ttl=1000) : _server(port), _ttl(ttl) {};
+    bool add(shellyDevice &device, const char* name); // name is used in path, e.g. "plug1"
+    void begin();   // start server
+    void handle();  // call from loop() to serve requests
+    void setTTL(unsigned long ttl) { _ttl = ttl; }; // time responses are cached [ms]
+    // forward methods matching pattern, pattern is not copied
+    // returns false if SHELLY_GATEWAY_ALLOWED is reached
+    bool allow(const char* pattern);
+    void disallowAll() { _numAllowed = 0; }; // remove all patterns including defaults
+    unsigned long upstreamRequests() { return _upstream; }; // requests sent to devices
+    unsigned long cacheHits() { return _hits; };            // requests answered from cache
+private:
+    WebServer _server;
+    unsigned long _ttl;
+    shellyDevice* _devices[SHELLY_GATEWAY_DEVICES];
+    const char* _names[SHELLY_GATEWAY_DEVICES];
+    uint8_t _numDevices = 0;
+    const char* _allowed[SHELLY_GATEWAY_ALLOWED] = { "*.GetStatus", "*.GetConfig" };
+    uint8_t _numAllowed = 2;
+    shellyGatewayEntry _cache[SHELLY_GATEWAY_CACHE];
+    shellyPoller _poller;           // reads status of all devices for /status
+    unsigned long _upstream = 0;
+    unsigned long _hits = 0;
+    shellyGatewayEntry* lookup(uint8_t device, const String &method); // fresh cache entry or NULL
+    shellyGatewayEntry& store(uint8_t device, const String &method, int httpResponseCode, const String &payload);
+    void invalidate(uint8_t device);
+    bool allowed(const String &method);
+    static bool match(const char* pattern, const char* method);
+    static String urlEncode(const String &text);
+    void handleRpc();       // /<name>/rpc/<method>
+    void handleStatus();    // /status
+    void send(int httpResponseCode, const String &payload);
+};
+
+#endif
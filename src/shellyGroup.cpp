@@ -0,0 +1,90 @@
+#include "shellyGroup.h"
+
+bool shellyGroup::add(shellyDevice &device, const char* rpcMethod)
+{
+    return _poller.add(device, rpcMethod);
+}
+
+bool shellyGroup::addf(shellyDevice &device, const char* format, ...)
+{
+    char method[SHELLY_METHOD_LEN];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(method, sizeof(method), format, args);
+    va_end(args);
+    if ((n < 0) || (n >= (int)sizeof(method)))
+        return false;
+    return add(device, method);
+}
+
+bool shellyGroup::SwitchSet(shellySwitch &device, bool on, uint8_t id)
+{
+    return addf(device, "%s?id=%u&on=%s", shellyRpc::SwitchSet, id, on ? "true" : "false");
+}
+
+bool shellyGroup::SwitchToggle(shellySwitch &device, uint8_t id)
+{
+    return addf(device, "%s?id=%u", shellyRpc::SwitchToggle, id);
+}
+
+bool shellyGroup::CoverOpen(shellyCover &device, uint8_t id)
+{
+    return addf(device, "%s?id=%u", shellyRpc::CoverOpen, id);
+}
+
+bool shellyGroup::CoverClose(shellyCover &device, uint8_t id)
+{
+    return addf(device, "%s?id=%u", shellyRpc::CoverClose, id);
+}
+
+bool shellyGroup::CoverStop(shellyCover &device, uint8_t id)
+{
+    return addf(device, "%s?id=%u", shellyRpc::CoverStop, id);
+}
+
+bool shellyGroup::CoverGoToPosition(shellyCover &device, uint8_t pos, uint8_t id)
+{
+    return addf(device, "%s?id=%u&pos=%u", shellyRpc::CoverGoToPosition, id, pos);
+}
+
+bool shellyGroup::run()
+{
+    if (!start())
+        return false;
+    while (!done())
+    {
+        handle();
+        delay(1);
+    }
+    return succeeded();
+}
+
+bool shellyGroup::succeeded()
+{
+    if (!done() || (commands() == 0))
+        return false;
+    for (uint8_t i=0; i<commands(); i++)
+        if (result(i).httpResponseCode != HTTP_CODE_OK)
+            return false;
+    return true;
+}
+
+unsigned long shellyGroup::spread()
+{
+    if (!done() || (commands() == 0))
+        return 0;
+    // completion times relative to first start, robust against millis() overflow
+    unsigned long first = result(0).started;
+    for (uint8_t i=1; i<commands(); i++)
+        if ((long)(result(i).started - first) < 0)
+            first = result(i).started;
+    unsigned long earliest = result(0).started - first + result(0).duration;
+    unsigned long latest = earliest;
+    for (uint8_t i=1; i<commands(); i++)
+    {
+        unsigned long completed = result(i).started - first + result(i).duration;
+        earliest = min(earliest, completed);
+        latest = max(latest, completed);
+    }
+    return latest - earliest;
+}
@@ -0,0 +1,50 @@
+#ifndef _SHELLYGROUP_H_
+#define _SHELLYGROUP_H_
+#include <Arduino.h>
+#include "shellyDevice.h"
+#include "shellyPoller.h"
+
+// actuate several devices at once, e.g. to switch a scene
+// Commands are dispatched to all devices concurrently by a shellyPoller, so
+// devices react almost simultaneously instead of one after another. Per device
+// results and timings are available after run(), spread() tells how far apart
+// first and last device completed.
+//   shellyGroup allOff;
+//   allOff.SwitchSet(plugS_1, false);
+//   allOff.CoverClose(blindControl);
+//   allOff.run();
+//   Serial.println(String("spread ") + allOff.spread() + " ms");
+// NOTE: commands to the same device are processed one after another
+// NOTE: use at least as many workers as devices in the group (at most 8 tasks)
+
+class shellyGroup
+{
+public:
+    shellyGroup(uint8_t workers=8) : _poller(workers) {};
+    // add command to group, rpcMethod with parameters like "Switch.Set?id=0&on=true"
+    bool add(shellyDevice &device, const char* rpcMethod);
+    bool SwitchSet(shellySwitch &device, bool on, uint8_t id=0);
+    bool SwitchToggle(shellySwitch &device, uint8_t id=0);
+    bool CoverOpen(shellyCover &device, uint8_t id=0);
+    bool CoverClose(shellyCover &device, uint8_t id=0);
+    bool CoverStop(shellyCover &device, uint8_t id=0);
+    bool CoverGoToPosition(shellyCover &device, uint8_t pos, uint8_t id=0);
+    bool clear() { return _poller.clear(); }; // remove all commands
+    // send all commands and wait for completion, returns true if all succeeded
+    bool run();
+    // non blocking alternative to run(): start(), then handle() from loop() until done()
+    bool start() { return _poller.start(); };
+    void handle() { _poller.handle(); };
+    bool done() { return !_poller.running(); };
+    // results of last run
+    uint8_t commands() { return _poller.jobs(); };
+    const shellyPollJob& result(uint8_t i) { return _poller.job(i); }; // httpResponseCode, payload, started, duration
+    bool succeeded();               // all commands returned HTTP_CODE_OK
+    unsigned long spread();         // [ms] between first and last completion
+    unsigned long duration() { return _poller.cycleTime(); }; // [ms] for all commands
+private:
+    shellyPoller _poller;
+    bool addf(shellyDevice &device, const char* format, ...);
+};
+
+#endif
@@ -0,0 +1,199 @@
+#include "shellyJson.h"
+
+void shellyJsonScanner::reset()
+{
+    _state = VALUE;
+    _escape = false;
+    _pathOverflow = false;
+    _depth = 0;
+    _pathLen = 0;
+    _valueLen = 0;
+    _path[0] = 0;
+    _value[0] = 0;
+#if SHELLY_STATS
+    _parseTime = 0;
+#endif
+}
+
+void shellyJsonScanner::scan(const char* json)
+{
+    while (*json)
+        parse(*json++);
+}
+
+size_t shellyJsonScanner::write(const uint8_t *buffer, size_t size)
+{
+#if SHELLY_STATS
+    unsigned long start = micros();
+#endif
+    for (size_t i=0; i<size; i++)
+        parse((char)buffer[i]);
+#if SHELLY_STATS
+    _parseTime += micros() - start;
+#endif
+    return size;
+}
+
+// enter object or array
+void shellyJsonScanner::push(bool isArray)
+{
+    if (_depth >= SHELLY_JSON_DEPTH)
+    {
+        _state = ERROR; // nested too deep, ignore rest of document
+        return;
+    }
+    _outerOverflow[_depth] = _pathOverflow;
+    _brackets[_depth] = false;
+    if (isArray) // elements of array are reported as path[]
+    {
+        if (_pathLen < SHELLY_JSON_PATH-3)
+        {
+            _path[_pathLen++] = '[';
+            _path[_pathLen++] = ']';
+            _path[_pathLen] = 0;
+            _brackets[_depth] = true;
+        }
+        else
+            _pathOverflow = true;
+    }
+    _isArray[_depth] = isArray;
+    _base[_depth] = _pathLen;
+    _baseOverflow[_depth] = _pathOverflow; // values below a truncated path are not reported
+    _depth++;
+    _state = isArray ? VALUE : KEY;
+}
+
+// leave object or array, restore path of parent
+void shellyJsonScanner::pop()
+{
+    if (_depth == 0)
+    {
+        _state = ERROR; // unbalanced
+        return;
+    }
+    _depth--;
+    _pathLen = _base[_depth];
+    if (_brackets[_depth])
+        _pathLen -= 2; // remove [] added by push, required for arrays of arrays
+    _path[_pathLen] = 0;
+    _pathOverflow = _outerOverflow[_depth];
+    _state = AFTER_VALUE;
+}
+
+// pass complete value to callback
+void shellyJsonScanner::emit()
+{
+    _value[_valueLen] = 0;
+    if (!_pathOverflow)
+        _onValue(_path, _value);
+    _valueLen = 0;
+}
+
+void shellyJsonScanner::parse(char c)
+{
+    switch (_state)
+    {
+    case IN_KEY:
+        if (_escape)
+            _escape = false;
+        else if (c == '\\')
+        {
+            _escape = true;
+            return;
+        }
+        else if (c == '"')
+        {
+            _path[_pathLen] = 0;
+            _state = COLON;
+            return;
+        }
+        if (_pathLen < SHELLY_JSON_PATH-1)
+            _path[_pathLen++] = c;
+        else
+            _pathOverflow = true;
+        return;
+    case IN_STRING:
+        if (_escape)
+            _escape = false;
+        else if (c == '\\')
+        {
+            _escape = true;
+            return;
+        }
+        else if (c == '"')
+        {
+            emit();
+            _state = AFTER_VALUE;
+            return;
+        }
+        if (_valueLen < _valueSize-1)
+            _value[_valueLen++] = c;
+        return;
+    case IN_SCALAR:
+        if ((c != ',') && (c != '}') && (c != ']') && (c != ' ') && (c != '\t') && (c != '\r') && (c != '\n'))
+        {
+            if (_valueLen < _valueSize-1)
+                _value[_valueLen++] = c;
+            return;
+        }
+        emit(); // end of scalar, character is handled below
+        _state = AFTER_VALUE;
+        break;
+    case ERROR:
+        return;
+    default:
+        break;
+    }
+
+    if ((c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'))
+        return; // skip whitespace between tokens
+    switch (_state)
+    {
+    case KEY: // start of key or end of (empty) object
+        if (c == '"')
+        {
+            // path of key is path of object + "." + key
+            _pathLen = _base[_depth-1];
+            _pathOverflow = _baseOverflow[_depth-1];
+            if (_pathLen >= SHELLY_JSON_PATH-2) // no space for "." and key
+                _pathOverflow = true;
+            else if (_pathLen > 0)
+                _path[_pathLen++] = '.';
+            _state = IN_KEY;
+        }
+        else if (c == '}')
+            pop();
+        else
+            _state = ERROR;
+        break;
+    case COLON:
+        _state = (c == ':') ? VALUE : ERROR;
+        break;
+    case VALUE:
+        if (c == '{')
+            push(false);
+        else if (c == '[')
+            push(true);
+        else if ((c == ']') && (_depth > 0) && _isArray[_depth-1])
+            pop(); // empty array
+        else if (c == '"')
+            _state = IN_STRING;
+        else
+        {
+            _value[0] = c;
+            _valueLen = 1;
+            _state = IN_SCALAR;
+        }
+        break;
+    case AFTER_VALUE:
+        if ((c == ',') && (_depth > 0))
+            _state = _isArray[_depth-1] ? VALUE : KEY;
+        else if ((c == '}') || (c == ']'))
+            pop();
+        else
+            _state = ERROR;
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef _SHELLYJSON_H_
+#define _SHELLYJSON_H_
+#include <Arduino.h>
+#include <functional>
+#include "shellyStats.h"
+
+// streaming JSON scanner used to decode responses of shelly devices
+// The response body is written to the scanner (e.g. by HTTPClient::writeToStream)
+// and parsed in a single pass using constant memory. For each scalar value
+// (number, string, true/false/null) the callback is called with the full path
+// of keys separated by '.', e.g. "temperature.tC" or "switch:0.apower".
+// Arrays add "[]" to the path, e.g. "aenergy.by_minute[]" or "events[].component".
+// NOTE: paths or values exceeding the buffers below are skipped (paths)
+// or truncated (values). A larger value buffer could be supplied to the constructor.
+
+#ifndef SHELLY_JSON_PATH
+#define SHELLY_JSON_PATH 48 // maximum length of path including terminating 0
+#endif
+#ifndef SHELLY_JSON_VALUE
+#define SHELLY_JSON_VALUE 24 // maximum length of value including terminating 0
+#endif
+#ifndef SHELLY_JSON_DEPTH
+#define SHELLY_JSON_DEPTH 8 // maximum nesting of objects and arrays
+#endif
+
+class shellyJsonScanner : public Stream
+{
+public:
+    typedef std::function<void(const char* path, const char* value)> callback;
+    shellyJsonScanner(callback onValue, char* valueBuffer=NULL, size_t valueSize=0) : 
+        _onValue(onValue),
+        _value(valueBuffer ? valueBuffer : _valueBuffer),
+        _valueSize(valueBuffer ? valueSize : sizeof(_valueBuffer)) { reset(); };
+    void reset();                   // start new document
+    void scan(const char* json);    // parse (part of) document from string
+    bool complete() { return (_state == AFTER_VALUE) && (_depth == 0); }; // document parsed completely
+#if SHELLY_STATS
+    unsigned long parseTime() { return _parseTime; }; // time spent parsing since reset() [us]
+#endif
+    // Stream interface, any data written is parsed
+    size_t write(uint8_t c) override { parse((char)c); return 1; };
+    size_t write(const uint8_t *buffer, size_t size) override;
+    int available() override { return 0; };
+    int read() override { return -1; };
+    int peek() override { return -1; };
+private:
+    enum state : uint8_t { VALUE, KEY, IN_KEY, COLON, IN_STRING, IN_SCALAR, AFTER_VALUE, ERROR };
+    callback _onValue;
+    state _state;
+    bool _escape;                   // last character has been '\' in string
+    bool _pathOverflow;             // key did not fit into _path
+    uint8_t _depth;                 // current nesting level
+    uint8_t _pathLen;
+    size_t _valueLen;
+    bool _isArray[SHELLY_JSON_DEPTH];  // type of nesting level
+    uint8_t _base[SHELLY_JSON_DEPTH];  // length of path at start of nesting level
+    bool _baseOverflow[SHELLY_JSON_DEPTH]; // path truncated at start of nesting level
+    bool _outerOverflow[SHELLY_JSON_DEPTH]; // path truncated before nesting level, restored by pop()
+    bool _brackets[SHELLY_JSON_DEPTH];  // "[]" added to path by push(), removed by pop()
+    char _path[SHELLY_JSON_PATH];
+    char* _value;
+    size_t _valueSize;
+    char _valueBuffer[SHELLY_JSON_VALUE];
+#if SHELLY_STATS
+    unsigned long _parseTime;
+#endif
+    void parse(char c);
+    void push(bool isArray);
+    void pop();
+    void emit();
+};
+
+// helpers to convert values passed to callback
+inline bool shellyJsonBool(const char* value) { return strcmp(value, "true") == 0; };
+
+#endif
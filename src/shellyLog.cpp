@@ -0,0 +1,482 @@
+#include "shellyLog.h"
+
+// little endian numbers and varints used in file
+
+static void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void put32(uint8_t* p, uint32_t v)
+{
+    for (uint8_t i=0; i<4; i++)
+        p[i] = v >> (8*i);
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t putVarint(uint8_t* p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80)
+    {
+        p[n++] = v | 0x80;
+        v >>= 7;
+    }
+    p[n++] = v;
+    return n;
+}
+
+static bool getVarint(const uint8_t* p, size_t len, size_t &pos, uint64_t &v)
+{
+    v = 0;
+    for (uint8_t shift=0; (pos < len) && (shift < 64); shift += 7)
+    {
+        uint8_t b = p[pos++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if ((b & 0x80) == 0)
+            return true;
+    }
+    return false; // truncated
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+int shellyLog::add(const char* name, float scale, std::function<float()> read)
+{
+    if (_begun || (_channels >= SHELLY_LOG_CHANNELS))
+        return -1;
+    strncpy(_names[_channels], name, SHELLY_LOG_NAME_LEN - 1);
+    _names[_channels][SHELLY_LOG_NAME_LEN - 1] = 0;
+    _scales[_channels] = (scale > 0) ? scale : 1;
+    _read[_channels] = read;
+    return _channels++;
+}
+
+int shellyLog::addActivePower(const char* name, shellySwitch &device, uint8_t id, float scale)
+{
+    return add(name, scale, [&device, id]() { return device.ActivePower(id); });
+}
+
+int shellyLog::addVoltage(const char* name, shellySwitch &device, uint8_t id, float scale)
+{
+    return add(name, scale, [&device, id]() { return device.Voltage(id); });
+}
+
+int shellyLog::addCurrent(const char* name, shellySwitch &device, uint8_t id, float scale)
+{
+    return add(name, scale, [&device, id]() { return device.Current(id); });
+}
+
+int shellyLog::addTemperature(const char* name, shellySwitch &device, uint8_t id, float scale)
+{
+    return add(name, scale, [&device, id]() { return device.TemperatureDegC(id); });
+}
+
+int shellyLog::addTemperature(const char* name, shellyTemperature &device, uint8_t id, float scale)
+{
+    return add(name, scale, [&device, id]() { return device.TemperatureDegC(id); });
+}
+
+int shellyLog::addTotalActivePower(const char* name, shellyEM &device, uint8_t id, float scale)
+{
+    return add(name, scale, [&device, id]() { return device.TotalActivePower(id); });
+}
+
+bool shellyLog::begin()
+{
+    if (_channels == 0)
+        return false;
+    _begun = true;
+    _used = 0;
+    _written = 0;
+    _blocks = 0;
+    _firstTs = 0;
+    _lastTs = 0;
+    if (!_fs.exists(_path))
+        return create();
+    File f = _fs.open(_path, "r");
+    if (!f)
+        return false;
+    size_t size = f.size();
+    if (size == 0) // created but header not written
+    {
+        f.close();
+        return create();
+    }
+    bool ok = (f.read(_block, SHELLY_LOG_BLOCK) == SHELLY_LOG_BLOCK);
+    f.close();
+    // channels of file must match
+    ok = ok && (memcmp(_block, "SHLG", 4) == 0) && (_block[4] == SHELLY_LOG_VERSION) &&
+        (_block[5] == _channels) && (get16(_block + 6) == SHELLY_LOG_BLOCK);
+    for (uint8_t i=0; ok && (i<_channels); i++)
+    {
+        const uint8_t* channel = _block + 8 + i * (SHELLY_LOG_NAME_LEN + 4);
+        uint32_t scale;
+        memcpy(&scale, &_scales[i], 4);
+        ok = (strncmp((const char*)channel, _names[i], SHELLY_LOG_NAME_LEN) == 0) &&
+            (get32(channel + SHELLY_LOG_NAME_LEN) == scale);
+    }
+    return ok && resume(size);
+}
+
+// write header of new file
+bool shellyLog::create()
+{
+    memset(_block, 0, SHELLY_LOG_BLOCK);
+    memcpy(_block, "SHLG", 4);
+    _block[4] = SHELLY_LOG_VERSION;
+    _block[5] = _channels;
+    put16(_block + 6, SHELLY_LOG_BLOCK);
+    for (uint8_t i=0; i<_channels; i++)
+    {
+        uint8_t* channel = _block + 8 + i * (SHELLY_LOG_NAME_LEN + 4);
+        uint32_t scale;
+        memcpy(&scale, &_scales[i], 4);
+        memcpy(channel, _names[i], strlen(_names[i]));
+        put32(channel + SHELLY_LOG_NAME_LEN, scale);
+    }
+    File f = _fs.open(_path, "w");
+    if (!f)
+        return false;
+    bool ok = (f.write(_block, SHELLY_LOG_BLOCK) == SHELLY_LOG_BLOCK);
+    f.close();
+    f = _fs.open(_indexPath, "w");
+    ok &= (bool)f;
+    f.close();
+    return ok;
+}
+
+// continue existing file
+bool shellyLog::resume(size_t size)
+{
+    size_t data = size - SHELLY_LOG_BLOCK;
+    _blocks = data / SHELLY_LOG_BLOCK;
+    size_t partial = data % SHELLY_LOG_BLOCK;
+    unsigned long total = _blocks + (partial > 0);
+    if (total == 0)
+        return true;
+
+    // rebuild index if incomplete, e.g. after reset between writing block and index
+    File f = _fs.open(_indexPath, "r");
+    bool complete = f && (f.size() == 4 * total);
+    f.close();
+    if (!complete)
+    {
+        File blocks = _fs.open(_path, "r");
+        File index = _fs.open(_indexPath, "w");
+        if (!blocks || !index)
+            return false;
+        uint8_t ts[4];
+        for (unsigned long b=0; b<total; b++)
+        {
+            blocks.seek((b + 1) * SHELLY_LOG_BLOCK);
+            blocks.read(ts, 4);
+            index.write(ts, 4);
+        }
+        blocks.close();
+        index.close();
+    }
+    _firstTs = blockTs(0);
+
+    // read last block to continue after last record
+    f = _fs.open(_path, "r");
+    if (!f)
+        return false;
+    size_t len = partial ? partial : SHELLY_LOG_BLOCK;
+    f.seek(total * SHELLY_LOG_BLOCK);
+    len = f.read(_block, len);
+    f.close();
+    size_t used = decode(_block, len, [this](uint32_t ts, const int32_t* values) {
+        _lastTs = ts;
+        memcpy(_last, values, 4 * _channels);
+        return true;
+    });
+    if (partial == 0)
+        return true;
+    _used = partial;
+    _written = partial;
+    if (used < partial) // incomplete record, continue in next block
+    {
+        memset(_block + _used, 0, SHELLY_LOG_BLOCK - _used);
+        _used = SHELLY_LOG_BLOCK;
+        return flush();
+    }
+    return true;
+}
+
+bool shellyLog::log(uint32_t ts)
+{
+    float values[SHELLY_LOG_CHANNELS];
+    for (uint8_t i=0; i<_channels; i++)
+        values[i] = _read[i] ? _read[i]() : NAN;
+    return log(ts, values);
+}
+
+bool shellyLog::log(uint32_t ts, const float* values)
+{
+    if (!_begun || ((_firstTs != 0) && (ts < _lastTs)))
+        return false;
+    int32_t v[SHELLY_LOG_CHANNELS];
+    for (uint8_t i=0; i<_channels; i++)
+    {
+        float scaled = roundf(values[i] * _scales[i]);
+        if (isnan(scaled))
+            v[i] = INT32_MIN;
+        else if (scaled >= 2147483520.0f) // largest float below INT32_MAX
+            v[i] = INT32_MAX;
+        else if (scaled <= -2147483520.0f)
+            v[i] = -INT32_MAX;
+        else
+            v[i] = scaled;
+    }
+    if (_used > 0)
+    {
+        // time and values relative to last record
+        uint8_t record[5 + 5 * SHELLY_LOG_CHANNELS];
+        size_t len = putVarint(record, (uint64_t)(ts - _lastTs) + 1);
+        for (uint8_t i=0; i<_channels; i++)
+            len += putVarint(record + len, zigzag((int64_t)v[i] - _last[i]));
+        if (_used + len <= SHELLY_LOG_BLOCK)
+        {
+            memcpy(_block + _used, record, len);
+            _used += len;
+        }
+        else // block is full, write it and start next block
+        {
+            memset(_block + _used, 0, SHELLY_LOG_BLOCK - _used);
+            _used = SHELLY_LOG_BLOCK;
+            if (!flush())
+                return false;
+        }
+    }
+    if (_used == 0) // start of block with absolute values
+    {
+        put32(_block, ts);
+        for (uint8_t i=0; i<_channels; i++)
+            put32(_block + 4 + 4 * i, v[i]);
+        _used = headerSize();
+        if (_firstTs == 0)
+            _firstTs = ts;
+    }
+    _lastTs = ts;
+    memcpy(_last, v, 4 * _channels);
+    return true;
+}
+
+bool shellyLog::flush()
+{
+    if (_used <= _written)
+        return true;
+    bool first = (_written == 0);
+    if (!append(_path, _block + _written, _used - _written))
+        return false;
+    _written = _used;
+    bool ok = !first || append(_indexPath, _block, 4); // index is rebuilt by begin() if this fails
+    if (_used == SHELLY_LOG_BLOCK)
+    {
+        _blocks++;
+        _used = 0;
+        _written = 0;
+    }
+    return ok;
+}
+
+bool shellyLog::append(const String &path, const uint8_t* data, size_t len)
+{
+    File f = _fs.open(path, "a");
+    if (!f)
+        return false;
+    bool ok = (f.write(data, len) == len);
+    f.close();
+    return ok;
+}
+
+uint32_t shellyLog::blockTs(unsigned long block)
+{
+    if ((block == _blocks) && (_used > 0))
+        return get32(_block);
+    uint8_t ts[4] = {};
+    File f = _fs.open(_indexPath, "r");
+    bool ok = f && f.seek(4 * block) && (f.read(ts, 4) == 4);
+    f.close();
+    if (!ok) // not in index, read block
+    {
+        f = _fs.open(_path, "r");
+        if (f && f.seek((block + 1) * SHELLY_LOG_BLOCK))
+            f.read(ts, 4);
+        f.close();
+    }
+    return get32(ts);
+}
+
+size_t shellyLog::decode(const uint8_t* block, size_t len, std::function<bool(uint32_t ts, const int32_t* values)> cb)
+{
+    size_t pos = headerSize();
+    if (len < pos)
+        return 0;
+    uint32_t ts = get32(block);
+    int32_t v[SHELLY_LOG_CHANNELS];
+    for (uint8_t i=0; i<_channels; i++)
+        v[i] = get32(block + 4 + 4 * i);
+    if (!cb(ts, v))
+        return pos;
+    while ((pos < len) && (block[pos] != 0)) // 0 marks end of records
+    {
+        size_t p = pos;
+        uint64_t dt, delta;
+        if (!getVarint(block, len, p, dt))
+            break;
+        int32_t next[SHELLY_LOG_CHANNELS];
+        uint8_t i = 0;
+        for (; (i<_channels) && getVarint(block, len, p, delta); i++)
+            next[i] = (int64_t)v[i] + unzigzag(delta);
+        if (i < _channels) // truncated record
+            break;
+        pos = p;
+        ts += dt - 1;
+        memcpy(v, next, 4 * _channels);
+        if (!cb(ts, v))
+            break;
+    }
+    return pos;
+}
+
+unsigned long shellyLog::read(uint32_t ts, uint32_t endTs, rowCallback cb, uint32_t step)
+{
+    unsigned long total = blocks();
+    if (!_begun || (total == 0))
+        return 0;
+    if (endTs == 0)
+        endTs = _lastTs;
+
+    // last block starting at or before ts
+    unsigned long lo = 0;
+    unsigned long hi = total - 1;
+    while (lo < hi)
+    {
+        unsigned long mid = (lo + hi + 1) / 2;
+        if (blockTs(mid) <= ts)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    unsigned long rows = 0;
+    bool done = false;
+    float values[SHELLY_LOG_CHANNELS];
+    // averages of current interval if step > 0
+    uint32_t interval = 0;
+    double sums[SHELLY_LOG_CHANNELS];
+    unsigned long counts[SHELLY_LOG_CHANNELS];
+    bool pending = false;
+    auto average = [&]() {
+        float means[SHELLY_LOG_CHANNELS];
+        for (uint8_t i=0; i<_channels; i++)
+        {
+            means[i] = counts[i] ? sums[i] / counts[i] : NAN;
+            sums[i] = 0;
+            counts[i] = 0;
+        }
+        cb(interval, means, _channels);
+        rows++;
+    };
+    for (uint8_t i=0; i<_channels; i++)
+    {
+        sums[i] = 0;
+        counts[i] = 0;
+    }
+    auto record = [&](uint32_t rts, const int32_t* v) {
+        if (rts < ts)
+            return true;
+        if (rts > endTs)
+        {
+            done = true;
+            return false;
+        }
+        for (uint8_t i=0; i<_channels; i++)
+            values[i] = (v[i] == INT32_MIN) ? NAN : v[i] / _scales[i];
+        if (step == 0)
+        {
+            cb(rts, values, _channels);
+            rows++;
+            return true;
+        }
+        uint32_t start = rts - rts % step;
+        if (pending && (start != interval))
+            average();
+        interval = start;
+        pending = true;
+        for (uint8_t i=0; i<_channels; i++)
+            if (!isnan(values[i]))
+            {
+                sums[i] += values[i];
+                counts[i]++;
+            }
+        return true;
+    };
+
+    File f;
+    uint8_t buffer[SHELLY_LOG_BLOCK];
+    for (unsigned long b=lo; (b<total) && !done; b++)
+    {
+        if (b == _blocks) // current block, may not be written yet
+        {
+            decode(_block, _used, record);
+            continue;
+        }
+        if (!f)
+            f = _fs.open(_path, "r");
+        if (!f || !f.seek((b + 1) * SHELLY_LOG_BLOCK))
+            break;
+        decode(buffer, f.read(buffer, SHELLY_LOG_BLOCK), record);
+    }
+    f.close();
+    if (pending)
+        average();
+    return rows;
+}
+
+unsigned long shellyLog::exportCSV(Print &out, uint32_t ts, uint32_t endTs, uint32_t step)
+{
+    // ts,plug,grid
+    // 1700000000,48.3,-1250.5
+    uint8_t decimals[SHELLY_LOG_CHANNELS];
+    out.print("ts");
+    for (uint8_t i=0; i<_channels; i++)
+    {
+        out.print(",");
+        out.print(_names[i]);
+        decimals[i] = 0;
+        for (float s=_scales[i]; (s > 1) && (decimals[i] < 6); s /= 10)
+            decimals[i]++;
+    }
+    out.println();
+    return read(ts, endTs, [&out, &decimals](uint32_t rts, const float* values, uint8_t count) {
+        out.print(rts);
+        for (uint8_t i=0; i<count; i++)
+        {
+            out.print(",");
+            if (!isnan(values[i]))
+                out.print(values[i], decimals[i]);
+        }
+        out.println();
+    }, step);
+}
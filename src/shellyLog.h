@@ -0,0 +1,97 @@
+#ifndef _SHELLYLOG_H_
+#define _SHELLYLOG_H_
+#include <Arduino.h>
+#include <FS.h>
+#include <functional>
+#include "shellyDevice.h"
+
+// compact binary log of readings like ActivePower() to flash, e.g. LittleFS
+// Each record holds a timestamp and one value per channel. Values are stored
+// as integers (value * scale) and encoded as differences to the previous record,
+// so a record of steady readings takes a few bytes only. Records are collected
+// in RAM and appended to the file in blocks, each block starts with absolute
+// values, an index of the first timestamp of each block allows to find a time
+// range without reading the whole file.
+//   shellyLog history(LittleFS, "/power.log");
+//   history.addActivePower("plug", plugS_1);    // 0.1 W resolution
+//   history.addTotalActivePower("grid", gridSupply);
+//   history.begin();
+//   history.log(time(NULL));                    // read and append all channels
+//   history.exportCSV(Serial, from, to, 900);   // 15 minute averages
+// NOTE: the set of channels is fixed per file, begin() fails if it does not match
+// NOTE: records not written yet are lost on reset, call flush() to write them
+//
+// File format (all numbers little endian), see examples/shellyLog.py to read on a host
+//   block 0      "SHLG", version (uint8), channels (uint8), block size (uint16),
+//                per channel name (16 bytes, 0 terminated) and scale (float32)
+//   block 1...   ts (uint32, unix time of first record), first values (int32 per channel),
+//                records: varint(dt + 1), zigzag varint(value - previous) per channel,
+//                0 after last record of block
+//   <path>.idx   ts of first record of each block (uint32)
+// Values not available (NAN) are stored as INT32_MIN.
+
+#ifndef SHELLY_LOG_CHANNELS
+#define SHELLY_LOG_CHANNELS 8   // maximum number of channels
+#endif
+#ifndef SHELLY_LOG_BLOCK
+#define SHELLY_LOG_BLOCK 512    // size of blocks in file, one block is buffered in RAM
+#endif
+#define SHELLY_LOG_NAME_LEN 16  // maximum length of channel names including terminating 0
+#define SHELLY_LOG_VERSION 1
+
+class shellyLog
+{
+public:
+    // ts is unix time of record, values[i] belongs to channel(i), NAN if not available
+    typedef std::function<void(uint32_t ts, const float* values, uint8_t count)> rowCallback;
+    shellyLog(fs::FS &fs, const char* path) : _fs(fs), _path(path), _indexPath(String(path) + ".idx") {};
+    // add channel before begin(), value is stored with resolution 1/scale
+    // returns index of channel or -1 if SHELLY_LOG_CHANNELS is reached
+    int add(const char* name, float scale, std::function<float()> read=nullptr);
+    // typical readings, read when log(ts) is called
+    int addActivePower(const char* name, shellySwitch &device, uint8_t id=0, float scale=10);
+    int addVoltage(const char* name, shellySwitch &device, uint8_t id=0, float scale=10);
+    int addCurrent(const char* name, shellySwitch &device, uint8_t id=0, float scale=1000);
+    int addTemperature(const char* name, shellySwitch &device, uint8_t id=0, float scale=10);
+    int addTemperature(const char* name, shellyTemperature &device, uint8_t id=0, float scale=10);
+    int addTotalActivePower(const char* name, shellyEM &device, uint8_t id=0, float scale=10);
+    bool begin();   // open or create file, false on error or if channels do not match the file
+    bool log(uint32_t ts);                      // read all channels and append record
+    bool log(uint32_t ts, const float* values); // append record, ts must not decrease
+    bool flush();   // write records collected to file
+    // pass records from ts to endTs to callback, averages over step seconds if step > 0
+    // returns number of rows passed
+    unsigned long read(uint32_t ts, uint32_t endTs, rowCallback cb, uint32_t step=0);
+    unsigned long exportCSV(Print &out, uint32_t ts, uint32_t endTs, uint32_t step=0);
+    uint32_t firstTimestamp() { return _firstTs; }; // 0 if empty
+    uint32_t lastTimestamp() { return _lastTs; };
+    unsigned long blocks() { return _blocks + (_used > 0); }; // blocks used in file
+    uint8_t channels() { return _channels; };
+    const char* channel(uint8_t i) { return (i < _channels) ? _names[i] : ""; };
+private:
+    fs::FS &_fs;
+    String _path;
+    String _indexPath;
+    uint8_t _channels = 0;
+    char _names[SHELLY_LOG_CHANNELS][SHELLY_LOG_NAME_LEN];
+    float _scales[SHELLY_LOG_CHANNELS];
+    std::function<float()> _read[SHELLY_LOG_CHANNELS];
+    bool _begun = false;
+    // current block
+    uint8_t _block[SHELLY_LOG_BLOCK];
+    uint16_t _used = 0;             // bytes of current block, 0 if not started
+    uint16_t _written = 0;          // bytes of current block written to file
+    unsigned long _blocks = 0;      // complete blocks in file
+    uint32_t _firstTs = 0;
+    uint32_t _lastTs = 0;
+    int32_t _last[SHELLY_LOG_CHANNELS]; // values of last record
+    bool create();
+    bool resume(size_t size);
+    bool append(const String &path, const uint8_t* data, size_t len);
+    uint32_t blockTs(unsigned long block); // first ts of block from index
+    size_t headerSize() { return 4 + 4 * _channels; };
+    // pass records of block to callback, returns bytes used
+    size_t decode(const uint8_t* block, size_t len, std::function<bool(uint32_t ts, const int32_t* values)> cb);
+};
+
+#endif
@@ -0,0 +1,261 @@
+#include "shellyPipeline.h"
+
+int shellyPipeline::add(const char* method, const char* params)
+{
+    if (_numCalls >= SHELLY_PIPELINE_MAX)
+        return -1;
+    shellyRpcCall &call = _calls[_numCalls];
+    call = shellyRpcCall();
+    call.method = method;
+    call.params = (params != NULL) ? params : "";
+    return _numCalls++;
+}
+
+// open new connection to device
+bool shellyPipeline::connect()
+{
+    if (!_device.connect(_client))
+        return false;
+    _client.setNoDelay(true);
+    return true;
+}
+
+int shellyPipeline::send()
+{
+    unsigned long start = millis();
+    bool pending[SHELLY_PIPELINE_MAX];
+    for (uint8_t i=0; i<_numCalls; i++)
+    {
+        pending[i] = true;
+        _calls[i].httpResponseCode = 0;
+        _calls[i].error = 0;
+        _calls[i].payload = "";
+    }
+    if (_device.rejected())
+    {
+        for (uint8_t i=0; i<_numCalls; i++)
+            _calls[i].httpResponseCode = SHELLY_ERROR_DOWN;
+        return 0; // fail fast, probe not due yet
+    }
+    // if we got a challenge before try to authenticate with cached nonce at first request
+    bool authenticate = (_device._password.length() > 0) && (_device._HA1[0] != 0);
+    int received = 0;
+    for (uint8_t attempt=0; attempt<2; attempt++) // retry once on stale connection or authentication challenge
+    {
+        if (_client.connected() && (millis() - _lastSend > _device._keepAlive))
+            _client.stop(); // probably closed by server meanwhile
+        bool reused = _client.connected();
+        if (!reused && !connect())
+        {
+            for (uint8_t i=0; i<_numCalls; i++)
+                if (pending[i])
+                    _calls[i].httpResponseCode = HTTPC_ERROR_CONNECTION_REFUSED;
+            break;
+        }
+        bool close = false;
+        _challenge[0] = 0;
+        if (write(pending, authenticate))
+            received += read(pending, close);
+        else
+            close = true;
+        if (close || (_device._keepAlive == 0))
+            _client.stop();
+        _lastSend = millis();
+
+        // server returned authentication challenge (first access or nonce expired)
+        bool challenged = (_challenge[0] != 0) && (_device._password.length() > 0) && (attempt == 0);
+        if (challenged)
+        {
+            _device.parseChallenge(_challenge);
+            _device._authChallenges++;
+            authenticate = true;
+        }
+        bool retry = false;
+        for (uint8_t i=0; i<_numCalls; i++)
+        {
+            int code = _calls[i].httpResponseCode;
+            pending[i] = pending[i] && (((code == HTTP_CODE_UNAUTHORIZED) && challenged) ||
+                ((code <= 0) && (code != SHELLY_ERROR_URL) && (reused || close)));
+            retry |= pending[i];
+        }
+        if (!retry)
+            break;
+    }
+    _device._lastRequest = millis(); // backoff of device down counts from here
+    _device.checkHealth((received > 0) ? HTTP_CODE_OK : HTTPC_ERROR_CONNECTION_REFUSED);
+    _roundTrip = millis() - start;
+    int results = 0;
+    for (uint8_t i=0; i<_numCalls; i++)
+        if ((_calls[i].httpResponseCode == HTTP_CODE_OK) && (_calls[i].error == 0))
+            results++;
+    return results;
+}
+
+// write requests of all pending calls at once, calls not fitting into request are no longer pending
+// POST /rpc HTTP/1.1 ... {"jsonrpc":"2.0","id":1,"method":"Switch.GetStatus","params":{"id":0}}
+bool shellyPipeline::write(bool* pending, bool authenticate)
+{
+    String requests;
+    requests.reserve(_numCalls * (authenticate ? 600 : 200));
+    for (uint8_t i=0; i<_numCalls; i++)
+    {
+        if (!pending[i])
+            continue;
+        shellyRpcCall &call = _calls[i];
+        call.id = ++_nextId;
+        call.httpResponseCode = 0;
+        char body[SHELLY_PIPELINE_BODY];
+        int len = snprintf(body, sizeof(body), "{\"jsonrpc\":\"2.0\",\"id\":%lu,\"method\":\"%s\"%s%s}",
+            call.id, call.method, call.params.length() ? ",\"params\":" : "", call.params.c_str());
+        if ((len < 0) || (len >= (int)sizeof(body)))
+        {
+            call.httpResponseCode = SHELLY_ERROR_URL;
+            pending[i] = false;
+            continue;
+        }
+        requests += "POST /rpc HTTP/1.1\r\nHost: ";
+        requests += _device.hostHeader();
+        requests += "\r\nContent-Type: application/json\r\n"
+            "Content-Length: " + String(len) + "\r\n";
+        if (authenticate)
+        {
+            char authString[320];
+            requests += "Authorization:";
+            requests += _device.authorization("/rpc", authString, sizeof(authString), "POST");
+            requests += "\r\n";
+        }
+        requests += "\r\n";
+        requests += body;
+    }
+    if (requests.length() == 0)
+        return false;
+    return _client.write((const uint8_t*)requests.c_str(), requests.length()) == requests.length();
+}
+
+// read responses in order of requests, set close if connection can not be used any more
+int shellyPipeline::read(bool* pending, bool &close)
+{
+    int received = 0;
+    for (uint8_t i=0; i<_numCalls; i++)
+    {
+        if (!pending[i])
+            continue;
+        unsigned long deadline = millis() + _device._readTimeout;
+        char line[200];
+        if (!readLine(line, sizeof(line), deadline) || (strncmp(line, "HTTP/1.", 7) != 0))
+        {
+            // no (valid) response, remaining responses can not be assigned
+            for (; i<_numCalls; i++)
+                if (pending[i] && (_calls[i].httpResponseCode == 0))
+                    _calls[i].httpResponseCode = HTTPC_ERROR_READ_TIMEOUT;
+            close = true;
+            break;
+        }
+        int httpResponseCode = atoi(line + 9);
+        size_t length = (size_t)-1; // read up to end of connection if not given
+        while (readLine(line, sizeof(line), deadline) && (line[0] != 0))
+        {
+            if (strncasecmp(line, "Content-Length:", 15) == 0)
+                length = strtoul(line + 15, NULL, 10);
+            else if (strncasecmp(line, "Connection:", 11) == 0)
+                close |= (strstr(line + 11, "close") != NULL);
+            else if (strncasecmp(line, "WWW-Authenticate:", 17) == 0)
+            {
+                const char* value = line + 17;
+                while (*value == ' ')
+                    value++;
+                strncpy(_challenge, value, sizeof(_challenge)-1);
+                _challenge[sizeof(_challenge)-1] = 0;
+            }
+        }
+        close |= (length == (size_t)-1);
+        String body;
+        if (!readBody(body, length, deadline) && (length != (size_t)-1))
+        {
+            for (; i<_numCalls; i++)
+                if (pending[i] && (_calls[i].httpResponseCode == 0))
+                    _calls[i].httpResponseCode = HTTPC_ERROR_READ_TIMEOUT;
+            close = true;
+            break;
+        }
+        received++;
+        // match response to call by id, error responses without id belong to call in order
+        int error = 0;
+        shellyRpcCall* call = (httpResponseCode == HTTP_CODE_OK) ? match(body, error) : NULL;
+        if (call == NULL)
+            call = &_calls[i];
+        call->httpResponseCode = httpResponseCode;
+        call->error = error;
+        call->payload = body;
+    }
+    return received;
+}
+
+// read line of header without line end, false on timeout or connection closed
+bool shellyPipeline::readLine(char* line, size_t size, unsigned long deadline)
+{
+    size_t len = 0;
+    line[0] = 0;
+    while ((long)(millis() - deadline) < 0)
+    {
+        if (_client.available() <= 0)
+        {
+            if (!_client.connected())
+                return false;
+            delay(1);
+            continue;
+        }
+        char c = _client.read();
+        if (c == '\n')
+            return true;
+        if ((c != '\r') && (len < size-1)) // excess characters are skipped
+        {
+            line[len++] = c;
+            line[len] = 0;
+        }
+    }
+    return false;
+}
+
+// read body of length bytes, false on timeout or connection closed before
+bool shellyPipeline::readBody(String &body, size_t length, unsigned long deadline)
+{
+    char buffer[129];
+    while ((body.length() < length) && ((long)(millis() - deadline) < 0))
+    {
+        int n = _client.available();
+        if (n <= 0)
+        {
+            if (!_client.connected())
+                return false;
+            delay(1);
+            continue;
+        }
+        size_t missing = length - body.length();
+        n = _client.read((uint8_t*)buffer, min((size_t)n, min(missing, sizeof(buffer)-1)));
+        if (n <= 0)
+            continue;
+        buffer[n] = 0;
+        body += buffer;
+    }
+    return body.length() >= length;
+}
+
+// {"id":1,"src":"shellyplus2pm-...","result":{"id":0, ... }}
+// {"id":1,"src":"shellyplus2pm-...","error":{"code":-105,"message":"Argument 'id', value 5 not found!"}}
+shellyRpcCall* shellyPipeline::match(const String &body, int &error)
+{
+    long id = -1;
+    error = 0;
+    shellyJsonScanner json([&id, &error](const char* path, const char* value) {
+        if (strcmp(path, "id") == 0)
+            id = atol(value);
+        else if (strcmp(path, "error.code") == 0)
+            error = atoi(value);
+    });
+    json.scan(body.c_str());
+    for (uint8_t i=0; i<_numCalls; i++)
+        if ((long)_calls[i].id == id)
+            return &_calls[i];
+    return NULL;
+}
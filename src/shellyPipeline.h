@@ -0,0 +1,71 @@
+#ifndef _SHELLYPIPELINE_H_
+#define _SHELLYPIPELINE_H_
+#include <Arduino.h>
+#include "shellyTransport.h"
+#include "shellyDevice.h"
+#include "shellyJson.h"
+
+// several RPC calls to one device in a single round trip
+// https://shelly-api-docs.shelly.cloud/gen2/General/RPCProtocol
+// Calls are sent as JSON-RPC 2.0 requests (HTTP POST to /rpc), all requests
+// are written to one keep-alive connection before the first response is read
+// (HTTP pipelining). Responses are matched to calls by their id, so polling
+// several components costs about one round trip instead of one per call.
+//   shellyPipeline poll(shelly2PM);
+//   poll.add(shellyRpc::SwitchGetStatus, "{\"id\":0}");
+//   poll.add(shellyRpc::SwitchGetStatus, "{\"id\":1}");
+//   poll.add(shellyRpc::InputGetStatus, "{\"id\":0}");
+//   poll.send();    // poll.call(i).payload is {"id":...,"src":"...","result":{...}}
+// NOTE: calls are kept, call send() again to repeat them, clear() to start a new set
+// NOTE: uses a connection of its own, digest authentication (nonce, nonce count) and
+//       circuit breaker are shared with GET requests of the device
+
+#ifndef SHELLY_PIPELINE_MAX
+#define SHELLY_PIPELINE_MAX 8 // maximum number of calls sent at once
+#endif
+#ifndef SHELLY_PIPELINE_BODY
+#define SHELLY_PIPELINE_BODY 160 // maximum length of JSON-RPC request of one call
+#endif
+
+// one call and its response
+struct shellyRpcCall
+{
+    const char* method = "";        // e.g. "Switch.GetStatus"
+    String params;                  // JSON object, e.g. {"id":0}, empty if none
+    unsigned long id = 0;           // JSON-RPC id of last request
+    int httpResponseCode = 0;       // result of last request, 0 if no response
+    int error = 0;                  // code of JSON-RPC error response, 0 if result received
+    String payload;                 // complete response
+};
+
+class shellyPipeline
+{
+public:
+    shellyPipeline(shellyDevice &device) : _device(device) {};
+    // add call, method is not copied, returns index of call or -1 if SHELLY_PIPELINE_MAX is reached
+    int add(const char* method, const char* params=NULL);
+    void clear() { _numCalls = 0; }; // remove all calls
+    // send all calls and read responses, returns number of calls answered with a result
+    int send();
+    uint8_t calls() { return _numCalls; };
+    const shellyRpcCall& call(uint8_t i) { return _calls[i]; };
+    unsigned long roundTrip() { return _roundTrip; }; // duration of last send() [ms]
+    void disconnect() { _client.stop(); };
+private:
+    shellyDevice &_device;
+    WiFiClient _client;             // kept open between sends
+    shellyRpcCall _calls[SHELLY_PIPELINE_MAX];
+    uint8_t _numCalls = 0;
+    unsigned long _nextId = 0;
+    unsigned long _lastSend = 0;    // millis() at end of last send
+    unsigned long _roundTrip = 0;
+    char _challenge[200];           // WWW-Authenticate header of last 401 response
+    bool connect();
+    bool write(bool* pending, bool authenticate); // send requests of pending calls
+    int read(bool* pending, bool &close);         // read responses, returns number received
+    bool readLine(char* line, size_t size, unsigned long deadline);
+    bool readBody(String &body, size_t length, unsigned long deadline);
+    shellyRpcCall* match(const String &body, int &error); // call with id of response
+};
+
+#endif
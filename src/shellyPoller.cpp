@@ -0,0 +1,210 @@
+#include "shellyPoller.h"
+
+shellyPoller::~shellyPoller()
+{
+#ifdef ESP32
+    for (uint8_t i=0; i<_numTasks; i++)
+        vTaskDelete(_tasks[i]);
+    if (_devices != NULL)
+        vQueueDelete(_devices);
+    if (_done != NULL)
+        vQueueDelete(_done);
+#else
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (uint8_t i=0; i<_numTasks; i++)
+        _tasks[i].join(); // waits for current request
+#endif
+}
+
+bool shellyPoller::add(shellyDevice &device, String rpcMethod)
+{
+    if (running() || (_numJobs >= SHELLY_POLL_MAX_JOBS))
+        return false;
+    _jobs[_numJobs].device = &device;
+    _jobs[_numJobs].rpcMethod = rpcMethod;
+    _numJobs++;
+    return true;
+}
+
+bool shellyPoller::clear()
+{
+    if (running())
+        return false;
+    _numJobs = 0;
+    return true;
+}
+
+// process single request, called by worker tasks
+void shellyPoller::run(shellyPollJob &job)
+{
+    job.started = millis();
+    if (job.rpcMethod.length() > 0)
+        job.httpResponseCode = job.device->GET(job.rpcMethod, job.payload);
+    else
+        job.httpResponseCode = job.device->refresh() ? HTTP_CODE_OK : -1;
+    job.duration = millis() - job.started;
+}
+
+// pass completed request to callback, called from handle()
+void shellyPoller::complete(shellyPollJob &job)
+{
+    if (_onResult)
+        _onResult(job);
+    if (--_pending == 0)
+        _cycleTime = millis() - _cycleStart;
+}
+
+// clear results of all jobs, done before any job is queued as workers may
+// complete jobs of a device while later devices are still being queued
+void shellyPoller::reset()
+{
+    for (uint8_t i=0; i<_numJobs; i++)
+    {
+        _jobs[i].httpResponseCode = 0;
+        _jobs[i].payload = "";
+        _jobs[i].duration = 0;
+    }
+}
+
+// queue first job of each device only, worker will process all jobs of this device
+bool shellyPoller::firstOfDevice(uint8_t i)
+{
+    for (uint8_t j=0; j<i; j++)
+        if (_jobs[j].device == _jobs[i].device)
+            return false;
+    return true;
+}
+
+#ifdef ESP32
+
+// worker task, processes all jobs of a device one after another
+void shellyPoller::worker(void* poller)
+{
+    shellyPoller* p = (shellyPoller*)poller;
+    uint8_t first;
+    while (true)
+    {
+        if (xQueueReceive(p->_devices, &first, portMAX_DELAY) != pdTRUE)
+            continue;
+        for (uint8_t i=first; i<p->_numJobs; i++)
+        {
+            if (p->_jobs[i].device != p->_jobs[first].device)
+                continue;
+            p->run(p->_jobs[i]);
+            xQueueSend(p->_done, &i, portMAX_DELAY);
+        }
+    }
+}
+
+bool shellyPoller::start()
+{
+    if (running() || (_numJobs == 0))
+        return false;
+    if (_devices == NULL) // first cycle, create queues and worker tasks
+    {
+        _devices = xQueueCreate(SHELLY_POLL_MAX_JOBS, sizeof(uint8_t));
+        _done = xQueueCreate(SHELLY_POLL_MAX_JOBS, sizeof(uint8_t));
+        uint8_t numTasks = min(_workers, (uint8_t)SHELLY_POLL_MAX_WORKERS);
+        for (_numTasks=0; (_numTasks<numTasks) && (_devices != NULL) && (_done != NULL); _numTasks++)
+            if (xTaskCreate(worker, "shellyPoll", SHELLY_POLL_STACK, this, 1, &_tasks[_numTasks]) != pdPASS)
+                break;
+    }
+    if (_numTasks == 0) // no worker could be created, e.g. out of memory, try again next time
+    {
+        if (_devices != NULL)
+            vQueueDelete(_devices);
+        if (_done != NULL)
+            vQueueDelete(_done);
+        _devices = NULL;
+        _done = NULL;
+        _pending = 0;
+        return false;
+    }
+    _cycleStart = millis();
+    _pending = _numJobs;
+    reset();
+    for (uint8_t i=0; i<_numJobs; i++)
+        if (firstOfDevice(i))
+            xQueueSend(_devices, &i, 0);
+    return true;
+}
+
+void shellyPoller::handle()
+{
+    uint8_t i;
+    while (running() && (xQueueReceive(_done, &i, 0) == pdTRUE))
+        complete(_jobs[i]);
+}
+
+#else
+
+// worker thread, processes all jobs of a device one after another
+void shellyPoller::worker()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _wake.wait(lock, [this]() { return _stop || !_devices.empty(); });
+        if (_stop)
+            return;
+        uint8_t first = _devices.front();
+        _devices.pop_front();
+        lock.unlock();
+        for (uint8_t i=first; i<_numJobs; i++)
+        {
+            if (_jobs[i].device != _jobs[first].device)
+                continue;
+            run(_jobs[i]);
+            std::lock_guard<std::mutex> done(_mutex);
+            _done.push_back(i);
+        }
+        lock.lock();
+    }
+}
+
+bool shellyPoller::start()
+{
+    if (running() || (_numJobs == 0))
+        return false;
+    if (_numTasks == 0) // first cycle, create worker threads
+    {
+        uint8_t numTasks = min(_workers, (uint8_t)SHELLY_POLL_MAX_WORKERS);
+        for (_numTasks=0; _numTasks<numTasks; _numTasks++)
+            _tasks[_numTasks] = std::thread(&shellyPoller::worker, this);
+    }
+    if (_numTasks == 0)
+        return false;
+    _cycleStart = millis();
+    _pending = _numJobs;
+    reset();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (uint8_t i=0; i<_numJobs; i++)
+            if (firstOfDevice(i))
+                _devices.push_back(i);
+    }
+    _wake.notify_all();
+    return true;
+}
+
+void shellyPoller::handle()
+{
+    while (running())
+    {
+        uint8_t i;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_done.empty())
+                return;
+            i = _done.front();
+            _done.pop_front();
+        }
+        complete(_jobs[i]);
+    }
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef _SHELLYPOLLER_H_
+#define _SHELLYPOLLER_H_
+#include <Arduino.h>
+#include <functional>
+#include "shellyDevice.h"
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#else
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#endif
+
+// poll a set of shelly devices concurrently
+// Requests to different devices are processed by a pool of worker tasks, so
+// a poll cycle takes about as long as the slowest device instead of the sum
+// of all devices. Requests to the same device are processed one after another.
+// Results are passed to the callback from handle(), to be called in loop().
+// NOTE: do not access devices added to the poller while running() is true
+// NOTE: without FreeRTOS (host build) worker threads are used instead of tasks
+// NOTE: at most SHELLY_POLL_MAX_WORKERS worker tasks are used, workers() tells how many
+//       have been created, start() fails if none could be created
+
+#ifndef SHELLY_POLL_MAX_JOBS
+#define SHELLY_POLL_MAX_JOBS 32 // maximum number of requests per poll cycle
+#endif
+#ifndef SHELLY_POLL_MAX_WORKERS
+#define SHELLY_POLL_MAX_WORKERS 8 // maximum number of worker tasks
+#endif
+#ifndef SHELLY_POLL_STACK
+#define SHELLY_POLL_STACK 8192 // stack size of worker tasks
+#endif
+
+// one request to a device and its result
+struct shellyPollJob
+{
+    shellyDevice* device = NULL;
+    String rpcMethod;               // empty to refresh() status of all components
+    int httpResponseCode = 0;       // result of last request, 0 while pending
+    String payload;                 // response (empty for refresh)
+    unsigned long started = 0;      // millis() at start of request
+    unsigned long duration = 0;     // [ms]
+};
+
+class shellyPoller
+{
+public:
+    typedef std::function<void(const shellyPollJob &job)> callback;
+    shellyPoller(uint8_t workers=4) : _workers(workers) {}; // workers are limited to SHELLY_POLL_MAX_WORKERS
+    ~shellyPoller();
+    // add request to poll cycle, empty rpcMethod reads status of all components using refresh()
+    bool add(shellyDevice &device, String rpcMethod="");
+    bool clear();       // remove all requests, false if cycle is still running
+    uint8_t jobs() { return _numJobs; };
+    const shellyPollJob& job(uint8_t i) { return _jobs[i]; };
+    void onResult(callback cb) { _onResult = cb; }; // called from handle() for each completed request
+    bool start();       // start new poll cycle, false if last cycle is still running
+    bool running() { return _pending > 0; };
+    void handle();      // call from loop() to pass completed requests to callback
+    unsigned long cycleTime() { return _cycleTime; }; // duration of last complete cycle [ms]
+    uint8_t workers() { return _numTasks; }; // worker tasks created, 0 before first start()
+private:
+    shellyPollJob _jobs[SHELLY_POLL_MAX_JOBS];
+    uint8_t _numJobs = 0;
+    uint8_t _workers;
+    uint8_t _pending = 0;           // requests of current cycle not passed to callback yet
+    callback _onResult;
+    unsigned long _cycleStart = 0;
+    unsigned long _cycleTime = 0;
+    uint8_t _numTasks = 0;
+    void run(shellyPollJob &job);   // process single request
+    void complete(shellyPollJob &job);
+    void reset();                   // clear results of all jobs
+    bool firstOfDevice(uint8_t i);  // job i is the first one of its device
+#ifdef ESP32
+    QueueHandle_t _devices = NULL;  // index of first job of device to process
+    QueueHandle_t _done = NULL;     // index of completed jobs
+    TaskHandle_t _tasks[SHELLY_POLL_MAX_WORKERS];
+    static void worker(void* poller);
+#else
+    std::thread _tasks[SHELLY_POLL_MAX_WORKERS];
+    std::mutex _mutex;              // protects _devices, _done and _stop
+    std::condition_variable _wake;  // signals _devices or _stop to workers
+    std::deque<uint8_t> _devices;   // index of first job of device to process
+    std::deque<uint8_t> _done;      // index of completed jobs
+    bool _stop = false;             // workers end, set by destructor
+    void worker();
+#endif
+};
+
+#endif
@@ -0,0 +1,159 @@
+#include "shellyScheduler.h"
+
+int shellyScheduler::add(const char* name, std::function<bool(float &value)> read,
+    unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    return add(name, NULL, 0, read, nullptr, minInterval, maxInterval, deadband);
+}
+
+int shellyScheduler::add(const char* name, const void* source, uint8_t sourceId, std::function<bool(float &value)> read,
+    std::function<float()> cached, unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    if (_count >= SHELLY_SCHEDULE_MAX)
+        return -1;
+    shellyScheduledReading &r = _readings[_count];
+    r = shellyScheduledReading();
+    r.name = name;
+    r.read = read;
+    r.source = source;
+    r.sourceId = sourceId;
+    r.cached = cached;
+    r.minInterval = minInterval;
+    r.maxInterval = (maxInterval > minInterval) ? maxInterval : minInterval;
+    r.deadband = deadband;
+    r.interval = minInterval;
+    r.nextPoll = millis(); // poll as soon as possible
+    return _count++;
+}
+
+int shellyScheduler::addActivePower(shellySwitch &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    return add("ActivePower", &device, id, [&device, id](float &value) {
+        bool ok = device.SwitchRefresh(id);
+        value = device.ActivePower(id);
+        return ok;
+    }, [&device, id]() { return device.ActivePower(id); }, minInterval, maxInterval, deadband);
+}
+
+int shellyScheduler::addTotalActivePower(shellyEM &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    return add("TotalActivePower", &device, id, [&device, id](float &value) {
+        bool ok = device.EMRefresh(id);
+        value = device.TotalActivePower(id);
+        return ok;
+    }, [&device, id]() { return device.TotalActivePower(id); }, minInterval, maxInterval, deadband);
+}
+
+int shellyScheduler::addTemperature(shellySwitch &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    return add("TemperatureDegC", &device, id, [&device, id](float &value) {
+        bool ok = device.SwitchRefresh(id);
+        value = device.TemperatureDegC(id);
+        return ok;
+    }, [&device, id]() { return device.TemperatureDegC(id); }, minInterval, maxInterval, deadband);
+}
+
+int shellyScheduler::addTemperature(shellyTemperature &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    return add("TemperatureDegC", &device, id, [&device, id](float &value) {
+        bool ok = device.TemperatureRefresh(id);
+        value = device.TemperatureDegC(id);
+        return ok;
+    }, [&device, id]() { return device.TemperatureDegC(id); }, minInterval, maxInterval, deadband);
+}
+
+int shellyScheduler::addWiFiRSSI(shellyWiFi &device, unsigned long minInterval, unsigned long maxInterval, float deadband)
+{
+    return add("WiFiRSSI", &device, 0, [&device](float &value) {
+        bool ok = device.WiFiRefresh();
+        value = device.WiFiRSSI();
+        return ok;
+    }, [&device]() { return device.WiFiRSSI(); }, minInterval, maxInterval, deadband);
+}
+
+bool shellyScheduler::handle()
+{
+    // refill request budget, at most one second of requests could be used at once
+    unsigned long now = millis();
+    // at least one request, budgets below 1 request per second would never allow a poll
+    _tokens += _budget * (now - _lastRefill) / 1000.0;
+    if (_tokens > max(_budget, 1.0f))
+        _tokens = max(_budget, 1.0f);
+    _lastRefill = now;
+    if (_tokens < 1)
+        return false;
+
+    // reading due for the longest time
+    shellyScheduledReading* due = NULL;
+    for (uint8_t i=0; i<_count; i++)
+    {
+        shellyScheduledReading &r = _readings[i];
+        if ((long)(now - r.nextPoll) < 0)
+            continue;
+        if ((due == NULL) || ((long)(r.nextPoll - due->nextPoll) < 0))
+            due = &r;
+    }
+    if (due == NULL)
+        return false;
+    _tokens -= 1;
+    _requests++;
+    poll(*due);
+    return true;
+}
+
+void shellyScheduler::poll(shellyScheduledReading &r)
+{
+    float value;
+    bool ok = r.read(value);
+    unsigned long now = millis();
+    update(r, ok, value, now);
+    // readings of same component are updated from status read without another request
+    if (r.source == NULL)
+        return;
+    for (uint8_t i=0; i<_count; i++)
+    {
+        shellyScheduledReading &other = _readings[i];
+        if ((&other != &r) && (other.source == r.source) && (other.sourceId == r.sourceId))
+            update(other, ok, ok ? other.cached() : NAN, now);
+    }
+}
+
+void shellyScheduler::update(shellyScheduledReading &r, bool ok, float value, unsigned long now)
+{
+    r.polls++;
+    unsigned long interval = (r.interval > 0) ? r.interval : 1; // allow growing from minInterval 0
+    if (!ok) // device not available, retry slower
+    {
+        r.interval = min(2*interval, r.maxInterval);
+        r.nextPoll = now + r.interval;
+        return;
+    }
+    // smoothed rate of change since last poll
+    if (!isnan(r.value) && (now != r.lastPoll))
+    {
+        float rate = fabs(value - r.value) * 1000.0 / (now - r.lastPoll);
+        r.rate = 0.5 * (r.rate + rate);
+    }
+    r.value = value;
+    r.lastPoll = now;
+    if (isnan(r.reported) || (fabs(value - r.reported) >= r.deadband))
+    {
+        // changed, poll fast to follow transient
+        r.reported = value;
+        r.changes++;
+        r.interval = r.minInterval;
+        if (_onChange)
+            _onChange(r);
+    }
+    else
+    {
+        // time expected until value changes by deadband, interval grows by factor 2 at most
+        float expected = (r.rate > 0) ? 1000.0 * r.deadband / r.rate : r.maxInterval;
+        if (expected > 2.0 * interval)
+            expected = 2.0 * interval;
+        r.interval = (expected < r.maxInterval) ? (unsigned long)expected : r.maxInterval;
+        if (r.interval < r.minInterval)
+            r.interval = r.minInterval;
+    }
+    r.nextPoll = now + r.interval;
+}
@@ -0,0 +1,81 @@
+#ifndef _SHELLYSCHEDULER_H_
+#define _SHELLYSCHEDULER_H_
+#include <Arduino.h>
+#include <functional>
+#include "shellyDevice.h"
+
+// adaptive polling of readings like ActivePower() of several devices
+// Each reading is polled between minInterval and maxInterval. The interval
+// follows the recent rate of change: a reading changing by more than its
+// deadband is polled again after minInterval, the interval grows towards
+// maxInterval while the reading is steady (time expected to change by deadband).
+// Polls are limited to a global budget of requests per second, if more
+// readings are due the one waiting longest is polled first.
+// The callback is called if a reading changed by at least deadband since last reported.
+//   shellyScheduler scheduler(5); // at most 5 requests per second
+//   scheduler.addActivePower(plugS_1, 0, 250, 10000, 5.0); // poll every 0.25 ... 10 s, report changes >= 5 W
+// NOTE: call handle() from loop(), one request is sent per call
+// NOTE: typical readings are polled by XRefresh() ignoring statusTTL, readings of the
+//       same component (e.g. ActivePower() and TemperatureDegC() of a switch) share
+//       this request: polling one of them updates the others as well
+
+#ifndef SHELLY_SCHEDULE_MAX
+#define SHELLY_SCHEDULE_MAX 16 // maximum number of readings
+#endif
+
+// reading polled by scheduler
+struct shellyScheduledReading
+{
+    const char* name = "";
+    std::function<bool(float &value)> read; // poll value, returns false on error
+    const void* source = NULL;          // component read, NULL if not shared with other readings
+    uint8_t sourceId = 0;               // id of component
+    std::function<float()> cached;      // value from status of source read by other reading
+    unsigned long minInterval = 1000;   // [ms]
+    unsigned long maxInterval = 60000;  // [ms]
+    float deadband = 0;                 // changes below are not reported
+    float value = NAN;                  // last value read
+    float reported = NAN;               // last value passed to callback
+    float rate = 0;                     // smoothed rate of change [1/s]
+    unsigned long interval = 0;         // current interval [ms]
+    unsigned long lastPoll = 0;         // millis() of last poll
+    unsigned long nextPoll = 0;         // millis() poll is due
+    unsigned long polls = 0;
+    unsigned long changes = 0;          // changes reported
+};
+
+class shellyScheduler
+{
+public:
+    typedef std::function<void(const shellyScheduledReading &reading)> changeCallback;
+    shellyScheduler(float requestsPerSecond=10) : _budget(requestsPerSecond), _tokens(requestsPerSecond) {};
+    // add reading polled by read, returns index of reading or -1 if SHELLY_SCHEDULE_MAX is reached
+    int add(const char* name, std::function<bool(float &value)> read,
+        unsigned long minInterval, unsigned long maxInterval, float deadband);
+    // typical readings
+    int addActivePower(shellySwitch &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband);
+    int addTotalActivePower(shellyEM &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband);
+    int addTemperature(shellySwitch &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband);
+    int addTemperature(shellyTemperature &device, uint8_t id, unsigned long minInterval, unsigned long maxInterval, float deadband);
+    int addWiFiRSSI(shellyWiFi &device, unsigned long minInterval, unsigned long maxInterval, float deadband);
+    void onChange(changeCallback cb) { _onChange = cb; };
+    void setBudget(float requestsPerSecond) { _budget = requestsPerSecond; };
+    bool handle();  // poll reading due, returns true if a request has been done
+    uint8_t readings() { return _count; };
+    const shellyScheduledReading& reading(uint8_t i) { return _readings[i]; };
+    unsigned long requests() { return _requests; }; // total polls done
+private:
+    shellyScheduledReading _readings[SHELLY_SCHEDULE_MAX];
+    uint8_t _count = 0;
+    float _budget;                  // requests per second
+    float _tokens;                  // requests available now
+    unsigned long _lastRefill = 0;
+    unsigned long _requests = 0;
+    changeCallback _onChange;
+    int add(const char* name, const void* source, uint8_t sourceId, std::function<bool(float &value)> read,
+        std::function<float()> cached, unsigned long minInterval, unsigned long maxInterval, float deadband);
+    void poll(shellyScheduledReading &r);
+    void update(shellyScheduledReading &r, bool ok, float value, unsigned long now);
+};
+
+#endif
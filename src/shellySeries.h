@@ -0,0 +1,250 @@
+#ifndef _SHELLYSERIES_H_
+#define _SHELLYSERIES_H_
+#include <Arduino.h>
+
+// fixed memory time series of readings like ActivePower() or TotalActivePower()
+// Keeps the latest RAW samples and aggregates (minimum, maximum, mean, energy)
+// of periods at three resolutions (default 1 s, 1 min, 15 min), e.g.
+//   shellySeries<100, 60, 60, 96> power; // 100 samples, 60 s, 60 min, 24 h of 15 min
+// Aggregates are updated with each sample, so no samples need to be kept to
+// query them. Memory used is fixed by the template parameters (see sizeof).
+// Periods are aligned to multiples of their length in millis(), periods without
+// samples are not stored.
+// NOTE: energy is the integral of value over time in [value * h], e.g. Wh for power in W
+
+#ifndef SHELLY_SERIES_GAP
+#define SHELLY_SERIES_GAP 60000 // samples further apart [ms] are not integrated to energy
+#endif
+
+struct shellySample
+{
+    unsigned long ms = 0; // millis() of sample
+    float value = 0;
+};
+
+// aggregate of samples within a period or window
+struct shellyAggregate
+{
+    unsigned long start = 0;    // millis() of first sample
+    uint32_t count = 0;         // number of samples
+    float minimum = 0;
+    float maximum = 0;
+    double sum = 0;             // sum of values
+    double energy = 0;          // integral of value over time [value * h]
+    float mean() const { return count ? sum / count : 0; };
+    void add(float value, unsigned long ms, double integral)
+    {
+        if (count == 0)
+        {
+            start = ms;
+            minimum = maximum = value;
+        }
+        else if (value < minimum)
+            minimum = value;
+        else if (value > maximum)
+            maximum = value;
+        count++;
+        sum += value;
+        energy += integral;
+    };
+};
+
+// completed period including running totals of all samples up to its end
+struct shellyBucket : shellyAggregate
+{
+    uint32_t totalCount = 0;
+    double totalSum = 0;
+    double totalEnergy = 0;
+};
+
+// fixed capacity ring, index 0 is newest item
+template <class T, uint16_t N> class shellyRing
+{
+public:
+    void push(const T &item) { _items[_head] = item; _head = (_head + 1) % N; if (_size < N) _size++; };
+    void clear() { _head = 0; _size = 0; };
+    uint16_t size() const { return _size; };
+    const T& operator[](uint16_t i) const { return _items[(_head + N - 1 - i) % N]; };
+private:
+    T _items[N];
+    uint16_t _head = 0;
+    uint16_t _size = 0;
+};
+
+// interface used by components to record readings to a series of any size
+class shellySeriesBase
+{
+public:
+    virtual void add(float value, unsigned long ms) = 0;
+};
+
+template <uint16_t RAW, uint16_t N0=60, uint16_t N1=60, uint16_t N2=96>
+class shellySeries : public shellySeriesBase
+{
+public:
+    static const uint8_t LEVELS = 3;
+    // length of periods of the three levels [ms]
+    shellySeries(unsigned long period0=1000, unsigned long period1=60000, unsigned long period2=900000)
+        : _period{period0, period1, period2} {};
+    void add(float value, unsigned long ms) override;
+    void add(float value) { add(value, millis()); };
+    void clear();
+    // raw samples, 0 is newest
+    uint16_t samples() const { return _raw.size(); };
+    const shellySample& sample(uint16_t i) const { return _raw[i]; };
+    // period of level (0..2) currently filled
+    const shellyAggregate& current(uint8_t level) const { return _current[level]; };
+    // completed periods of level, 0 is latest
+    uint16_t periods(uint8_t level) const;
+    const shellyBucket& period(uint8_t level, uint16_t i) const;
+    // aggregate of latest count completed periods of level
+    // count, sum and energy are calculated in constant time from running totals,
+    // minimum and maximum are merged from the periods
+    shellyAggregate window(uint8_t level, uint16_t count) const;
+    float mean(uint8_t level, uint16_t count) const;      // O(1)
+    double energy(uint8_t level, uint16_t count) const;   // O(1)
+    const shellyAggregate& total() const { return _total; }; // all samples since start
+private:
+    unsigned long _period[LEVELS];
+    shellyRing<shellySample, RAW> _raw;
+    shellyRing<shellyBucket, N0> _level0;
+    shellyRing<shellyBucket, N1> _level1;
+    shellyRing<shellyBucket, N2> _level2;
+    shellyAggregate _current[LEVELS];
+    shellyAggregate _total;
+    void close(uint8_t level); // store current period of level
+};
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+void shellySeries<RAW, N0, N1, N2>::add(float value, unsigned long ms)
+{
+    // trapezoidal integration from previous sample
+    double integral = 0;
+    if (_raw.size() > 0)
+    {
+        const shellySample &last = _raw[0];
+        unsigned long dt = ms - last.ms;
+        if (dt < SHELLY_SERIES_GAP)
+            integral = (last.value + value) / 2.0 * dt / 3600000.0;
+    }
+    for (uint8_t level=0; level<LEVELS; level++)
+    {
+        // close current period if sample belongs to a later one
+        if ((_current[level].count > 0) &&
+            (ms - ms % _period[level] != _current[level].start - _current[level].start % _period[level]))
+            close(level);
+        _current[level].add(value, ms, integral);
+    }
+    _total.add(value, ms, integral);
+    shellySample sample;
+    sample.ms = ms;
+    sample.value = value;
+    _raw.push(sample);
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+void shellySeries<RAW, N0, N1, N2>::close(uint8_t level)
+{
+    shellyBucket bucket;
+    (shellyAggregate&)bucket = _current[level];
+    // totals up to end of this period, all its samples have been added to _total already
+    bucket.totalCount = _total.count;
+    bucket.totalSum = _total.sum;
+    bucket.totalEnergy = _total.energy;
+    switch (level)
+    {
+    case 0: _level0.push(bucket); break;
+    case 1: _level1.push(bucket); break;
+    default: _level2.push(bucket); break;
+    }
+    _current[level] = shellyAggregate();
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+void shellySeries<RAW, N0, N1, N2>::clear()
+{
+    _raw.clear();
+    _level0.clear();
+    _level1.clear();
+    _level2.clear();
+    for (uint8_t level=0; level<LEVELS; level++)
+        _current[level] = shellyAggregate();
+    _total = shellyAggregate();
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+uint16_t shellySeries<RAW, N0, N1, N2>::periods(uint8_t level) const
+{
+    switch (level)
+    {
+    case 0: return _level0.size();
+    case 1: return _level1.size();
+    default: return _level2.size();
+    }
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+const shellyBucket& shellySeries<RAW, N0, N1, N2>::period(uint8_t level, uint16_t i) const
+{
+    switch (level)
+    {
+    case 0: return _level0[i];
+    case 1: return _level1[i];
+    default: return _level2[i];
+    }
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+shellyAggregate shellySeries<RAW, N0, N1, N2>::window(uint8_t level, uint16_t count) const
+{
+    shellyAggregate result;
+    if (count > periods(level))
+        count = periods(level);
+    if (count == 0)
+        return result;
+    // running totals at end of latest period minus those before oldest period of window
+    const shellyBucket &latest = period(level, 0);
+    const shellyBucket &oldest = period(level, count-1);
+    result.start = oldest.start;
+    result.count  = latest.totalCount  - (oldest.totalCount  - oldest.count);
+    result.sum    = latest.totalSum    - (oldest.totalSum    - oldest.sum);
+    result.energy = latest.totalEnergy - (oldest.totalEnergy - oldest.energy);
+    result.minimum = latest.minimum;
+    result.maximum = latest.maximum;
+    for (uint16_t i=1; i<count; i++)
+    {
+        const shellyBucket &p = period(level, i);
+        if (p.minimum < result.minimum)
+            result.minimum = p.minimum;
+        if (p.maximum > result.maximum)
+            result.maximum = p.maximum;
+    }
+    return result;
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+float shellySeries<RAW, N0, N1, N2>::mean(uint8_t level, uint16_t count) const
+{
+    if (count > periods(level))
+        count = periods(level);
+    if (count == 0)
+        return 0;
+    const shellyBucket &latest = period(level, 0);
+    const shellyBucket &oldest = period(level, count-1);
+    uint32_t n = latest.totalCount - (oldest.totalCount - oldest.count);
+    return n ? (latest.totalSum - (oldest.totalSum - oldest.sum)) / n : 0;
+}
+
+template <uint16_t RAW, uint16_t N0, uint16_t N1, uint16_t N2>
+double shellySeries<RAW, N0, N1, N2>::energy(uint8_t level, uint16_t count) const
+{
+    if (count > periods(level))
+        count = periods(level);
+    if (count == 0)
+        return 0;
+    const shellyBucket &latest = period(level, 0);
+    const shellyBucket &oldest = period(level, count-1);
+    return latest.totalEnergy - (oldest.totalEnergy - oldest.energy);
+}
+
+#endif
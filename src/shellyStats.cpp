@@ -0,0 +1,116 @@
+#include "shellyStats.h"
+#if SHELLY_STATS
+
+const uint16_t shellyHistogram::limits[SHELLY_HISTOGRAM_BUCKETS-1] =
+    {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000};
+
+void shellyHistogram::add(unsigned long ms)
+{
+    uint8_t i = 0;
+    while ((i < SHELLY_HISTOGRAM_BUCKETS-1) && (ms >= limits[i]))
+        i++;
+    _buckets[i]++;
+    _count++;
+    _sum += ms;
+    if (ms > _max)
+        _max = ms;
+}
+
+void shellyHistogram::clear()
+{
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _sum = 0;
+    _max = 0;
+}
+
+unsigned long shellyHistogram::percentile(uint8_t p) const
+{
+    unsigned long needed = ((unsigned long long)_count * p + 99) / 100; // round up
+    unsigned long n = 0;
+    for (uint8_t i=0; i<SHELLY_HISTOGRAM_BUCKETS-1; i++)
+    {
+        n += _buckets[i];
+        if ((n >= needed) && (n > 0))
+            return min((unsigned long)limits[i], _max); // bucket may not be filled up to its limit
+    }
+    return _max; // last bucket has no upper limit
+}
+
+// compare method names up to parameters, long names are stored truncated
+static bool sameMethod(const char* name, const char* rpcMethod)
+{
+    size_t len = strcspn(rpcMethod, "?");
+    if (len > SHELLY_STATS_METHOD_LEN-1)
+        len = SHELLY_STATS_METHOD_LEN-1;
+    return (strlen(name) == len) && (strncmp(name, rpcMethod, len) == 0);
+}
+
+shellyMethodStats& shellyStats::method(const char* rpcMethod)
+{
+    for (uint8_t i=0; i<SHELLY_STATS_METHODS-1; i++)
+    {
+        if (methods[i].method[0] == 0) // free entry
+        {
+            size_t len = strcspn(rpcMethod, "?");
+            if (len > SHELLY_STATS_METHOD_LEN-1)
+                len = SHELLY_STATS_METHOD_LEN-1;
+            memcpy(methods[i].method, rpcMethod, len);
+            methods[i].method[len] = 0;
+            return methods[i];
+        }
+        if (sameMethod(methods[i].method, rpcMethod))
+            return methods[i];
+    }
+    // table full, last entry collects all other methods
+    shellyMethodStats &other = methods[SHELLY_STATS_METHODS-1];
+    strcpy(other.method, "other");
+    return other;
+}
+
+const shellyMethodStats* shellyStats::find(const char* rpcMethod) const
+{
+    for (uint8_t i=0; i<SHELLY_STATS_METHODS; i++)
+        if (sameMethod(methods[i].method, rpcMethod))
+            return &methods[i];
+    return NULL;
+}
+
+void shellyStats::clear()
+{
+    *this = shellyStats();
+}
+
+static void printHistogram(Print &out, const shellyHistogram &h)
+{
+    out.printf("{\"count\":%lu,\"mean\":%.1f,\"p50\":%lu,\"p99\":%lu,\"max\":%lu,\"buckets\":[",
+        h.count(), h.mean(), h.percentile(50), h.percentile(99), h.maximum());
+    for (uint8_t i=0; i<SHELLY_HISTOGRAM_BUCKETS; i++)
+        out.printf(i ? ",%lu" : "%lu", h.bucket(i));
+    out.print("]}");
+}
+
+// something like {"requests":12,"failures":0, ... ,"time_us":{"connect":8120, ...},"latency_ms":{...},"methods":{"Switch.GetStatus":{...}}}
+void shellyStats::print(Print &out) const
+{
+    out.printf("{\"requests\":%lu,\"failures\":%lu,\"rejected\":%lu,\"connects\":%lu,\"auth_challenges\":%lu,\"bytes\":%lu,",
+        requests, failures, rejected, connects, authChallenges, bytes);
+    out.printf("\"time_us\":{\"connect\":%llu,\"first_byte\":%llu,\"body\":%llu,\"auth\":%llu,\"parse\":%llu},",
+        connectTime, firstByteTime, bodyTime, authTime, parseTime);
+    out.print("\"latency_ms\":");
+    printHistogram(out, latency);
+    out.print(",\"methods\":{");
+    bool first = true;
+    for (uint8_t i=0; i<SHELLY_STATS_METHODS; i++)
+    {
+        if (methods[i].method[0] == 0)
+            continue;
+        out.printf("%s\"%s\":{\"failures\":%lu,\"latency_ms\":", first ? "" : ",", methods[i].method, methods[i].failures);
+        printHistogram(out, methods[i].latency);
+        out.print("}");
+        first = false;
+    }
+    out.println("}}");
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef _SHELLYSTATS_H_
+#define _SHELLYSTATS_H_
+#include <Arduino.h>
+
+// request statistics of a shelly device
+// Each shellyDevice counts requests, failures, bytes and authentication
+// challenges, sums up time spent in the phases of a request and keeps a
+// latency histogram per rpc method (e.g. "Switch.GetStatus").
+// Use device.stats() to read the counters or device.printStats(Serial) to
+// dump them as JSON.
+// NOTE: compile with -DSHELLY_STATS=0 to remove statistics entirely
+
+#ifndef SHELLY_STATS
+#define SHELLY_STATS 1 // 0 to disable statistics
+#endif
+#ifndef SHELLY_STATS_METHODS
+#define SHELLY_STATS_METHODS 8 // number of rpc methods tracked per device, further methods are counted as "other"
+#endif
+#ifndef SHELLY_STATS_METHOD_LEN
+#define SHELLY_STATS_METHOD_LEN 24 // maximum length of method name including terminating 0
+#endif
+
+#define SHELLY_HISTOGRAM_BUCKETS 13
+
+// latency histogram with fixed buckets (upper limits 1, 2, 5, 10, 20 ... 5000 ms, above)
+class shellyHistogram
+{
+public:
+    static const uint16_t limits[SHELLY_HISTOGRAM_BUCKETS-1]; // upper limit of buckets [ms]
+    void add(unsigned long ms);
+    void clear();
+    unsigned long count() const { return _count; };
+    unsigned long maximum() const { return _max; }; // [ms]
+    float mean() const { return _count ? (float)_sum / _count : 0; }; // [ms]
+    unsigned long percentile(uint8_t p) const;   // upper limit of bucket containing p% of requests, at most maximum() [ms]
+    unsigned long bucket(uint8_t i) const { return _buckets[i]; };
+private:
+    unsigned long _buckets[SHELLY_HISTOGRAM_BUCKETS] = {};
+    unsigned long _count = 0;
+    unsigned long _sum = 0;
+    unsigned long _max = 0;
+};
+
+// statistics of requests to one rpc method
+struct shellyMethodStats
+{
+    char method[SHELLY_STATS_METHOD_LEN] = ""; // without parameters, "" for unused entries
+    unsigned long failures = 0;
+    shellyHistogram latency;
+};
+
+// statistics of all requests to a device
+// times are summed up over all requests [us], divide by requests for mean values
+struct shellyStats
+{
+    unsigned long requests = 0;      // requests done by GET
+    unsigned long failures = 0;      // requests not returning HTTP 200
+    unsigned long rejected = 0;      // requests failed immediately as device is down
+    unsigned long connects = 0;      // new connections opened
+    unsigned long authChallenges = 0; // 401 challenges answered
+    unsigned long bytes = 0;         // response body bytes received
+    unsigned long long connectTime = 0;   // opening connections
+    unsigned long long firstByteTime = 0; // sending request until response header received
+    unsigned long long bodyTime = 0;      // reading response body (excluding parseTime)
+    unsigned long long authTime = 0;      // additional round trip to answer authentication challenge
+    unsigned long long parseTime = 0;     // decoding responses into status snapshots
+    shellyHistogram latency;         // all requests [ms]
+    shellyMethodStats methods[SHELLY_STATS_METHODS];
+    shellyMethodStats& method(const char* rpcMethod); // find or add entry for method, parameters are ignored
+    const shellyMethodStats* find(const char* rpcMethod) const; // NULL if method not tracked
+    void clear();
+    void print(Print &out) const; // write as JSON
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef _SHELLYTRANSPORT_H_
+#define _SHELLYTRANSPORT_H_
+
+// network transport used by the library
+// Devices are accessed using WiFiClient (TCP connection, used for pipelining and
+// WebSocket) and HTTPClient (HTTP/1.1 requests) of the ESP32 core. Building on a
+// Linux host (see CMakeLists.txt) the same interface is provided over POSIX sockets
+// by host/shellyHostTransport.h, so the library can be tested and benchmarked on a
+// computer, e.g. against examples/mockShelly.py.
+
+#ifdef ARDUINO
+#include <WiFi.h>
+#include <HTTPClient.h>
+#else
+#include <shellyHostTransport.h>
+#endif
+
+#endif
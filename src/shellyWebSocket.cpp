@@ -0,0 +1,379 @@
+#include "shellyWebSocket.h"
+
+// WebSocket opcodes, see RFC 6455
+#define WS_CONTINUATION 0x0
+#define WS_TEXT         0x1
+#define WS_CLOSE        0x8
+#define WS_PING         0x9
+#define WS_PONG         0xA
+
+// return rest of path after prefix, NULL if path does not start with prefix
+static const char* afterPrefix(const char* path, const char* prefix)
+{
+    size_t len = strlen(prefix);
+    return (strncmp(path, prefix, len) == 0) ? path + len : NULL;
+}
+
+// base64 encoding of len bytes from data to out (4*((len+2)/3)+1 chars)
+static void base64(const uint8_t* data, size_t len, char* out)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (size_t i=0; i<len; i+=3)
+    {
+        uint32_t n = (uint32_t)data[i] << 16;
+        if (i+1 < len) n |= (uint32_t)data[i+1] << 8;
+        if (i+2 < len) n |= data[i+2];
+        *out++ = table[(n >> 18) & 0x3f];
+        *out++ = table[(n >> 12) & 0x3f];
+        *out++ = (i+1 < len) ? table[(n >> 6) & 0x3f] : '=';
+        *out++ = (i+2 < len) ? table[n & 0x3f] : '=';
+    }
+    *out = 0;
+}
+
+shellyWebSocket::shellyWebSocket(shellyDevice &device) :
+    _device(device),
+    _json([this](const char* path, const char* value) { frameValue(path, value); }, _value, sizeof(_value))
+{
+    snprintf(_src, sizeof(_src), "shelly2http-%08lx", (unsigned long)random(0x7fffffffL));
+    _eventComponent[0] = 0;
+}
+
+bool shellyWebSocket::begin()
+{
+    _active = true;
+    return connect();
+}
+
+void shellyWebSocket::end()
+{
+    _active = false;
+    if (_state == OPEN)
+    {
+        uint8_t status[2] = {0x03, 0xE8}; // 1000, normal closure
+        sendFrame(WS_CLOSE, status, sizeof(status));
+    }
+    close();
+}
+
+// open TCP connection and send WebSocket handshake
+bool shellyWebSocket::connect()
+{
+    _lastAttempt = millis();
+    if (!_device.connect(_client))
+        return false;
+    uint8_t key[16];
+    for (int i=0; i<16; i++)
+        key[i] = random(256);
+    char keyBase64[25];
+    base64(key, sizeof(key), keyBase64);
+    _client.print("GET /rpc HTTP/1.1\r\n"
+        "Host: " + String(_device.hostHeader()) + "\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Key: " + keyBase64 + "\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "\r\n");
+    _state = HANDSHAKE;
+    _statusLine = true;
+    _lineLen = 0;
+    _hdrLen = 0;
+    _hdrNeed = 2;
+    _remaining = 0;
+    _authSent = false;
+    _authPending = false;
+    _pingSent = false;
+    _lastRx = millis();
+    return true;
+}
+
+// snapshots are no longer updated, do not serve them for a long statusTTL
+void shellyWebSocket::close()
+{
+    _client.stop();
+    if (_state == OPEN)
+        _device.invalidateStatus();
+    _state = CLOSED;
+}
+
+void shellyWebSocket::handle()
+{
+    if (!_active)
+        return;
+    if ((_state != CLOSED) && !_client.connected())
+        close(); // connection lost
+    if (_state == CLOSED)
+    {
+        if (millis() - _lastAttempt > SHELLY_WS_RECONNECT)
+            connect();
+        return;
+    }
+    uint8_t buffer[64];
+    int n;
+    while ((_client.available() > 0) && ((n = _client.read(buffer, sizeof(buffer))) > 0))
+    {
+        _lastRx = millis();
+        _pingSent = false;
+        for (int i=0; (i<n) && (_state != CLOSED); i++)
+        {
+            if (_state == HANDSHAKE)
+                handshake((char)buffer[i]);
+            else
+                receive(buffer[i]);
+        }
+    }
+    // check if connection is still alive
+    if ((_state != CLOSED) && (millis() - _lastRx > SHELLY_WS_PING))
+    {
+        if (_pingSent || (_state == HANDSHAKE))
+            close(); // no answer to ping, will reconnect
+        else if (sendFrame(WS_PING, NULL, 0))
+        {
+            _pingSent = true;
+            _lastRx = millis();
+        }
+    }
+}
+
+// process response to handshake, line by line
+void shellyWebSocket::handshake(char c)
+{
+    if (c != '\n')
+    {
+        if ((c != '\r') && (_lineLen < sizeof(_line)-1))
+            _line[_lineLen++] = c;
+        return;
+    }
+    _line[_lineLen] = 0;
+    if (_statusLine) // something like HTTP/1.1 101 Switching Protocols
+    {
+        _statusLine = false;
+        if (strstr(_line, " 101") == NULL)
+            close();
+    }
+    else if (_lineLen == 0) // empty line, end of header
+    {
+        _state = OPEN;
+        requestStatus(false); // device sends notifications after first request
+    }
+    _lineLen = 0;
+}
+
+// process byte of WebSocket frame
+void shellyWebSocket::receive(uint8_t c)
+{
+    if (_hdrLen < _hdrNeed) // frame header
+    {
+        _hdr[_hdrLen++] = c;
+        if (_hdrLen == 2) // length of extended payload length and mask
+        {
+            uint8_t len = _hdr[1] & 0x7f;
+            _hdrNeed = 2 + ((len == 126) ? 2 : (len == 127) ? 8 : 0) + ((_hdr[1] & 0x80) ? 4 : 0);
+        }
+        if (_hdrLen == _hdrNeed)
+            frameStart();
+        return;
+    }
+    if (_masked)
+        c ^= _mask[_payloadPos & 3];
+    _payloadPos++;
+    if (_opcode == WS_TEXT)
+        _json.write(c);
+    else if ((_opcode >= WS_CLOSE) && (_controlLen < sizeof(_control)))
+        _control[_controlLen++] = c;
+    if (--_remaining == 0)
+        frameEnd();
+}
+
+void shellyWebSocket::frameStart()
+{
+    uint8_t opcode = _hdr[0] & 0x0f;
+    _fin = (_hdr[0] & 0x80) != 0;
+    uint8_t len = _hdr[1] & 0x7f;
+    uint8_t pos = 2;
+    if (len == 126)
+    {
+        _remaining = ((uint32_t)_hdr[2] << 8) | _hdr[3];
+        pos = 4;
+    }
+    else if (len == 127) // more than 4GB are not expected
+    {
+        _remaining = ((uint32_t)_hdr[6] << 24) | ((uint32_t)_hdr[7] << 16) | ((uint32_t)_hdr[8] << 8) | _hdr[9];
+        pos = 10;
+    }
+    else
+        _remaining = len;
+    _masked = (_hdr[1] & 0x80) != 0; // not expected from server
+    if (_masked)
+        memcpy(_mask, _hdr + pos, 4);
+    _payloadPos = 0;
+    _controlLen = 0;
+    if (opcode == WS_TEXT) // start of new message
+    {
+        _json.reset();
+        _frameId = -1;
+        _frameMethod = NONE;
+        _frameError = 0;
+    }
+    if (opcode < WS_CLOSE) // data frame
+    {
+        if (opcode != WS_CONTINUATION)
+            _dataOpcode = opcode;
+        _opcode = _dataOpcode; // continuation frames keep opcode of message
+    }
+    else
+        _opcode = opcode; // control frame, could be sent between fragments
+    if (_remaining == 0)
+        frameEnd();
+}
+
+void shellyWebSocket::frameEnd()
+{
+    _hdrLen = 0;
+    _hdrNeed = 2;
+    switch (_opcode)
+    {
+    case WS_TEXT:
+        if (_fin && ((_frameMethod == NOTIFY_STATUS) || (_frameMethod == NOTIFY_EVENT)))
+            _notifications++;
+        if (_fin && _authPending) // answer authentication challenge
+        {
+            _authPending = false;
+            requestStatus(true);
+        }
+        break;
+    case WS_PING:
+        sendFrame(WS_PONG, _control, _controlLen);
+        break;
+    case WS_CLOSE:
+        sendFrame(WS_CLOSE, _control, min(_controlLen, (uint8_t)2));
+        close(); // will reconnect
+        break;
+    default: // pong, binary
+        break;
+    }
+}
+
+// value of received message, e.g.
+// {"src":"shellyplus1pm-...","dst":"shelly2http-...","method":"NotifyStatus","params":{"ts":1700000000.00,"switch:0":{"id":0,"apower":12.5}}}
+// {"id":1,"src":"shellyplus1pm-...","dst":"shelly2http-...","result":{"ble":{}, ... ,"wifi":{...}}}
+// {"id":1,"src":"shellyplus1pm-...","dst":"shelly2http-...","error":{"code":401,"message":"{\"auth_type\": \"digest\", ...}"}}
+void shellyWebSocket::frameValue(const char* path, const char* value)
+{
+    const char* field;
+    if (strcmp(path, "id") == 0)
+        _frameId = atol(value);
+    else if (strcmp(path, "method") == 0)
+    {
+        if ((strcmp(value, "NotifyStatus") == 0) || (strcmp(value, "NotifyFullStatus") == 0))
+            _frameMethod = NOTIFY_STATUS;
+        else if (strcmp(value, "NotifyEvent") == 0)
+            _frameMethod = NOTIFY_EVENT;
+        else
+            _frameMethod = OTHER;
+    }
+    else if (((field = afterPrefix(path, "result.")) != NULL) && (_frameId == (long)_statusId))
+        applyStatus(field, value);
+    else if (((field = afterPrefix(path, "params.")) != NULL) && (_frameMethod == NOTIFY_STATUS))
+    {
+        if (strcmp(field, "ts") != 0) // skip time stamp
+            applyStatus(field, value);
+    }
+    else if ((_frameMethod == NOTIFY_EVENT) && (strcmp(path, "params.events[].component") == 0))
+    {
+        strncpy(_eventComponent, value, sizeof(_eventComponent)-1);
+        _eventComponent[sizeof(_eventComponent)-1] = 0;
+    }
+    else if ((_frameMethod == NOTIFY_EVENT) && (strcmp(path, "params.events[].event") == 0))
+    {
+        if (_onEvent)
+            _onEvent(_eventComponent, value);
+    }
+    else if (strcmp(path, "error.code") == 0)
+        _frameError = atoi(value);
+    else if ((strcmp(path, "error.message") == 0) && (_frameError == 401) && !_authSent)
+        parseChallenge(value);
+}
+
+void shellyWebSocket::applyStatus(const char* path, const char* value)
+{
+    _device.decodeShellyStatus(path, value);
+    if (_onChange)
+        _onChange(path, value);
+}
+
+// challenge like {"auth_type": "digest", "nonce": 1625038762, "nc": 1, "realm": "shellypro4pm-f008d1d8b8b8", "algorithm": "SHA-256"}
+void shellyWebSocket::parseChallenge(const char* challenge)
+{
+    if (_device._password.length() == 0)
+        return; // can not authenticate
+    char buffer[sizeof(_device._realm)];
+    _authNonce[0] = 0;
+    strcpy(_authNC, "1");
+    shellyJsonScanner json([this](const char* path, const char* value) {
+        if (strcmp(path, "nonce") == 0)
+            strncpy(_authNonce, value, sizeof(_authNonce)-1);
+        else if (strcmp(path, "nc") == 0)
+            strncpy(_authNC, value, sizeof(_authNC)-1);
+        else if (strcmp(path, "realm") == 0)
+            _device.setRealm(value);
+    }, buffer, sizeof(buffer));
+    json.scan(challenge);
+    _authNonce[sizeof(_authNonce)-1] = 0;
+    _authNC[sizeof(_authNC)-1] = 0;
+    _authPending = (_authNonce[0] != 0);
+}
+
+// request status of all components, device will send notifications afterwards
+bool shellyWebSocket::requestStatus(bool authenticate)
+{
+    char auth[320] = "";
+    if (authenticate)
+    {
+        char cnonce[12];
+        char response[65];
+        snprintf(cnonce, sizeof(cnonce), "%ld", random(556822323L));
+        // HA2 = SHA256("dummy_method:dummy_uri") as given by shelly documentation for RPC channels
+        _device.digestResponse("dummy_method", "dummy_uri", _authNonce, _authNC, cnonce, "auth", response);
+        snprintf(auth, sizeof(auth), ",\"auth\":{\"realm\":\"%s\",\"username\":\"%s\",\"nonce\":%s,"
+            "\"cnonce\":%s,\"response\":\"%s\",\"algorithm\":\"SHA-256\"}",
+            _device._realm, _device._user.c_str(), _authNonce, cnonce, response);
+        _authSent = true;
+    }
+    char request[400];
+    _statusId = ++_requestId;
+    int len = snprintf(request, sizeof(request), "{\"id\":%lu,\"src\":\"%s\",\"method\":\"Shelly.GetStatus\"%s}",
+        _statusId, _src, auth);
+    return sendFrame(WS_TEXT, (const uint8_t*)request, len);
+}
+
+// send frame, client frames have to be masked
+bool shellyWebSocket::sendFrame(uint8_t opcode, const uint8_t* payload, size_t len)
+{
+    uint8_t hdr[8];
+    uint8_t n = 0;
+    hdr[n++] = 0x80 | opcode; // FIN
+    if (len < 126)
+        hdr[n++] = 0x80 | len;
+    else
+    {
+        hdr[n++] = 0x80 | 126;
+        hdr[n++] = len >> 8;
+        hdr[n++] = len & 0xff;
+    }
+    uint8_t* mask = hdr + n;
+    for (int i=0; i<4; i++)
+        hdr[n++] = random(256);
+    if (_client.write(hdr, n) != n)
+        return false;
+    uint8_t chunk[64];
+    for (size_t pos=0; pos<len; pos+=sizeof(chunk))
+    {
+        size_t size = min(len - pos, sizeof(chunk));
+        for (size_t i=0; i<size; i++)
+            chunk[i] = payload[pos+i] ^ mask[(pos+i) & 3];
+        if (_client.write(chunk, size) != size)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef _SHELLYWEBSOCKET_H_
+#define _SHELLYWEBSOCKET_H_
+#include <Arduino.h>
+#include <functional>
+#include "shellyTransport.h"
+#include "shellyDevice.h"
+#include "shellyJson.h"
+
+// event driven status of a shelly device using RPC over WebSocket
+// https://shelly-api-docs.shelly.cloud/gen2/General/RPCChannels#websocket
+// https://shelly-api-docs.shelly.cloud/gen2/General/Notifications
+// After connecting to ws://<device>/rpc Shelly.GetStatus is requested, using
+// digest authentication with the password of the device if required.
+// The device then pushes NotifyStatus frames for each change, which are applied
+// to the status snapshots of the device (see ShellyPlus1PM::ActivePower() ...),
+// and NotifyEvent frames (e.g. button pushed). The connection is reopened
+// automatically if lost.
+// NOTE: call handle() from loop() to process incoming frames
+// NOTE: increase statusTTL of device to use pushed status without polling, snapshots are
+//       invalidated if the connection closes, so accessors read them again while closed
+
+#ifndef SHELLY_WS_RECONNECT
+#define SHELLY_WS_RECONNECT 5000 // retry connecting after [ms]
+#endif
+#ifndef SHELLY_WS_PING
+#define SHELLY_WS_PING 30000 // send ping if idle for [ms], reconnect if no answer within same time
+#endif
+
+class shellyWebSocket
+{
+public:
+    typedef std::function<void(const char* path, const char* value)> changeCallback;
+    typedef std::function<void(const char* component, const char* event)> eventCallback;
+    shellyWebSocket(shellyDevice &device);
+    bool begin();       // connect and request status, reconnects automatically
+    void end();         // close connection
+    void handle();      // call from loop() to process incoming frames
+    bool connected() { return _state == OPEN; };
+    // status value received, e.g. ("switch:0.apower", "12.5"), called after status snapshot has been updated
+    void onChange(changeCallback cb) { _onChange = cb; };
+    // event received, e.g. ("input:0", "single_push")
+    void onEvent(eventCallback cb) { _onEvent = cb; };
+    unsigned long notifications() { return _notifications; }; // number of NotifyStatus/NotifyEvent messages received
+private:
+    enum wsState : uint8_t { CLOSED, HANDSHAKE, OPEN };
+    enum wsMethod : uint8_t { NONE, NOTIFY_STATUS, NOTIFY_EVENT, OTHER };
+    shellyDevice &_device;
+    WiFiClient _client;
+    shellyJsonScanner _json;    // parses text frames while receiving
+    char _value[200];           // value buffer of _json, large enough for authentication challenge
+    char _src[24];              // our id, used by device as destination of notifications
+    bool _active = false;       // begin() has been called
+    wsState _state = CLOSED;
+    unsigned long _lastAttempt = 0; // millis() of last connection attempt
+    unsigned long _lastRx = 0;  // millis() of last data received
+    bool _pingSent = false;
+    unsigned long _notifications = 0;
+    changeCallback _onChange;
+    eventCallback _onEvent;
+    // handshake
+    char _line[16];             // start of current header line
+    uint8_t _lineLen = 0;
+    bool _statusLine = true;    // first line of response expected
+    // frame receiving
+    uint8_t _hdr[14];
+    uint8_t _hdrLen = 0;
+    uint8_t _hdrNeed = 2;
+    uint8_t _opcode = 0;        // of current frame
+    uint8_t _dataOpcode = 0;    // of current message (text or binary)
+    bool _fin = false;
+    uint8_t _mask[4];
+    bool _masked = false;
+    uint32_t _remaining = 0;    // payload bytes of current frame
+    uint32_t _payloadPos = 0;
+    uint8_t _control[125];      // payload of control frames
+    uint8_t _controlLen = 0;
+    // current message
+    long _frameId = -1;
+    wsMethod _frameMethod = NONE;
+    int _frameError = 0;
+    char _eventComponent[24];
+    // requests and authentication
+    unsigned long _requestId = 0;
+    unsigned long _statusId = 0; // id of Shelly.GetStatus request
+    bool _authPending = false;   // challenge received, answer at end of frame
+    bool _authSent = false;      // answer challenge once per connection
+    char _authNonce[24];
+    char _authNC[12];
+    bool connect();
+    void close();
+    void handshake(char c);
+    void receive(uint8_t c);
+    void frameStart();
+    void frameEnd();
+    void frameValue(const char* path, const char* value);
+    void applyStatus(const char* path, const char* value);
+    void parseChallenge(const char* challenge);
+    bool requestStatus(bool authenticate);
+    bool sendFrame(uint8_t opcode, const uint8_t* payload, size_t len);
+};
+
+#endif
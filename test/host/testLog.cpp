@@ -0,0 +1,193 @@
+#include <Arduino.h>
+#include <FS.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "shellyLog.h"
+
+// shellyLog written in two sessions (resumed by a new object), read back by
+// exportCSV() and compared to examples/shellyLog.py with and without --step
+// (run by ctest, see CMakeLists.txt)
+
+#ifndef PYTHON
+#define PYTHON "python3"
+#endif
+#ifndef READER
+#define READER "examples/shellyLog.py"
+#endif
+
+#define START 1700000000UL
+#define RECORDS 4000 // per session, several blocks each
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    Serial.printf("%s %s\n", ok ? "ok    " : "FAILED", what);
+    if (!ok)
+        failures++;
+}
+
+// CSV output of exportCSV()
+class stringPrint : public Print
+{
+public:
+    std::string text;
+    size_t write(uint8_t c) override { text += (char)c; return 1; };
+    size_t write(const uint8_t* buffer, size_t size) override { text.append((const char*)buffer, size); return size; };
+    using Print::write;
+};
+
+static void addChannels(shellyLog &log)
+{
+    log.add("apower", 10);
+    log.add("voltage", 10);
+    log.add("current", 1000);
+}
+
+// readings of record i, current not available every 97th record
+static void values(unsigned long i, float* v)
+{
+    v[0] = 40 + (i % 50) * 1.3f - ((i / 7) % 3) * 20;
+    v[1] = 230 + (float)((i * 7) % 11) / 10;
+    v[2] = (i % 97 == 0) ? NAN : v[0] / v[1];
+}
+
+// record i is written at ts(i), some seconds apart
+static uint32_t ts(unsigned long i)
+{
+    return START + i * 10 + (i % 3);
+}
+
+static bool writeRecords(shellyLog &log, unsigned long from, unsigned long to)
+{
+    bool ok = true;
+    for (unsigned long i=from; i<to; i++)
+    {
+        float v[3];
+        values(i, v);
+        ok &= log.log(ts(i), v);
+    }
+    return ok && log.flush();
+}
+
+static std::vector<std::string> split(const std::string &s, char delimiter)
+{
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true)
+    {
+        size_t end = s.find(delimiter, start);
+        parts.push_back(s.substr(start, end - start));
+        if (end == std::string::npos)
+            return parts;
+        start = end + 1;
+    }
+}
+
+// same rows and values within last digit printed by exportCSV()
+static bool sameCSV(const std::string &csv, const std::string &reference)
+{
+    std::vector<std::string> rows = split(csv, '\n');
+    std::vector<std::string> refRows = split(reference, '\n');
+    while (!rows.empty() && rows.back().empty())
+        rows.pop_back();
+    while (!refRows.empty() && refRows.back().empty())
+        refRows.pop_back();
+    if (rows.size() != refRows.size())
+    {
+        Serial.printf("  %u rows, reader %u\n", (unsigned)rows.size(), (unsigned)refRows.size());
+        return false;
+    }
+    for (size_t r=0; r<rows.size(); r++)
+    {
+        std::string row = rows[r];
+        if (!row.empty() && row.back() == '\r')
+            row.pop_back();
+        std::vector<std::string> fields = split(row, ',');
+        std::vector<std::string> refFields = split(refRows[r], ',');
+        bool same = (fields.size() == refFields.size()) && (fields[0] == refFields[0]);
+        for (size_t f=1; same && (f<fields.size()); f++)
+        {
+            if (fields[f].empty() || refFields[f].empty())
+            {
+                same = fields[f].empty() && refFields[f].empty();
+                continue;
+            }
+            size_t point = fields[f].find('.');
+            int decimals = (point == std::string::npos) ? 0 : fields[f].length() - point - 1;
+            same = fabs(atof(fields[f].c_str()) - atof(refFields[f].c_str())) <= 1.01 * pow(10, -decimals);
+        }
+        if (!same)
+        {
+            Serial.printf("  row %u: %s\n  reader: %s\n", (unsigned)r, row.c_str(), refRows[r].c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string run(const std::string &command)
+{
+    std::string output;
+    FILE* pipe = popen(command.c_str(), "r");
+    if (pipe == nullptr)
+        return output;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), pipe)) > 0)
+        output.append(buffer, n);
+    pclose(pipe);
+    return output;
+}
+
+static void compare(shellyLog &log, const std::string &file, uint32_t from, uint32_t to, uint32_t step, const char* what)
+{
+    stringPrint csv;
+    log.exportCSV(csv, from, to, step);
+    std::string command = std::string(PYTHON) + " " + READER + " " + file
+        + " --from " + std::to_string(from) + " --to " + std::to_string(to);
+    if (step > 0)
+        command += " --step " + std::to_string(step);
+    check(sameCSV(csv.text, run(command)), what);
+}
+
+int main()
+{
+    char root[] = "/tmp/shellyLogXXXXXX";
+    if (mkdtemp(root) == nullptr)
+        return 1;
+    fs::FS flash(root);
+    std::string file = std::string(root) + "/power.log";
+    {
+        shellyLog log(flash, "/power.log");
+        addChannels(log);
+        check(log.begin(), "create");
+        check(writeRecords(log, 0, RECORDS), "first session written");
+        check(log.blocks() > 2, "several blocks");
+    }
+    shellyLog log(flash, "/power.log");
+    addChannels(log);
+    check(log.begin(), "resume");
+    check(log.firstTimestamp() == ts(0), "first timestamp after resume");
+    check(log.lastTimestamp() == ts(RECORDS-1), "last timestamp after resume");
+    check(writeRecords(log, RECORDS, 2*RECORDS), "second session written");
+    check(log.read(0, UINT32_MAX, [](uint32_t, const float*, uint8_t) {}) == 2*RECORDS, "all records read");
+    {
+        shellyLog other(flash, "/power.log");
+        other.add("apower", 10);
+        check(!other.begin(), "different channels refused");
+    }
+
+    compare(log, file, 0, UINT32_MAX, 0, "records equal reader");
+    compare(log, file, 0, UINT32_MAX, 900, "averages equal reader --step 900");
+    compare(log, file, ts(RECORDS/2)+1, ts(RECORDS*3/2), 0, "records from/to across sessions equal reader");
+    compare(log, file, ts(RECORDS/2)+1, ts(RECORDS*3/2), 300, "averages from/to equal reader --step 300");
+
+    flash.remove("/power.log");
+    flash.remove("/power.log.idx");
+    rmdir(root);
+    Serial.println(failures ? "FAILED" : "PASSED");
+    Serial.flush();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+#include <Arduino.h>
+#include "shellyPipeline.h"
+
+// shellyPipeline against examples/mockShelly.py (run by ctest, see CMakeLists.txt)
+// Several JSON-RPC calls are sent at once, responses must be matched by id, error
+// responses mapped to the call and an expired nonce (--nonce-ttl 0.5) answered by
+// authenticating again.
+
+#ifndef SERVER
+#define SERVER "127.0.0.1:18080"
+#endif
+#ifndef NONCE_TTL
+#define NONCE_TTL 500 // nonce of mock expires after [ms]
+#endif
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    Serial.printf("%s %s\n", ok ? "ok    " : "FAILED", what);
+    if (!ok)
+        failures++;
+}
+
+// payload is the response to call, i.e. has its id and expected content
+static bool answered(const shellyRpcCall &call, const char* content)
+{
+    char id[24];
+    snprintf(id, sizeof(id), "{\"id\":%lu,", call.id);
+    return (call.httpResponseCode == HTTP_CODE_OK) && call.payload.startsWith(id) &&
+        (call.payload.indexOf(content) >= 0);
+}
+
+static void checkCalls(shellyPipeline &pipeline, int results, const char* when)
+{
+    Serial.printf("%s: %d results in %lu ms\n", when, results, pipeline.roundTrip());
+    for (uint8_t i=0; i<pipeline.calls(); i++)
+        Serial.printf("  %d %lu %d %s\n", pipeline.call(i).httpResponseCode, pipeline.call(i).id,
+            pipeline.call(i).error, pipeline.call(i).payload.c_str());
+    check(results == 3, "3 calls answered with result");
+    check(answered(pipeline.call(0), "\"apower\":"), "Switch.GetStatus matched by id");
+    check(answered(pipeline.call(1), "\"uptime\":"), "Sys.GetStatus matched by id");
+    check(answered(pipeline.call(2), "\"error\":") && (pipeline.call(2).error == 404),
+        "error of unknown id mapped to call");
+    check(answered(pipeline.call(3), "\"gen\":2"), "Shelly.GetDeviceInfo matched by id");
+}
+
+int main()
+{
+    ShellyPlus1PM device(SERVER, "YourShellyPassword");
+    shellyPipeline pipeline(device);
+    pipeline.add(shellyRpc::SwitchGetStatus, "{\"id\":0}");
+    pipeline.add("Sys.GetStatus");
+    pipeline.add(shellyRpc::SwitchGetStatus, "{\"id\":5}"); // no switch:5
+    pipeline.add("Shelly.GetDeviceInfo");
+
+    checkCalls(pipeline, pipeline.send(), "first send");
+    check(device.authChallenges() == 1, "authenticated after challenge");
+    checkCalls(pipeline, pipeline.send(), "cached nonce");
+    check(device.authChallenges() == 1, "cached nonce accepted");
+    String status = device.GET(shellyRpc::ShellyGetStatus);
+    check((status.indexOf("\"switch:0\"") >= 0) && (device.authChallenges() == 1),
+        "GET uses nonce of pipeline");
+    delay(NONCE_TTL + 200);
+    checkCalls(pipeline, pipeline.send(), "nonce expired");
+    check(device.authChallenges() == 2, "challenged again");
+
+    Serial.println(failures ? "FAILED" : "PASSED");
+    Serial.flush();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+#include <Arduino.h>
+#include "shellyPoller.h"
+
+// shellyPoller against examples/mockShelly.py answering after DELAY ms (run by ctest,
+// see CMakeLists.txt). One device has 3 requests, three devices have one each, so
+// a cycle should take about as long as the slowest device (3 * DELAY) instead of
+// the sum of all requests (6 * DELAY), while handle() does not block loop().
+
+#ifndef SERVER
+#define SERVER "127.0.0.1:18080"
+#endif
+#ifndef DELAY
+#define DELAY 100 // response delay of mock [ms]
+#endif
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+    Serial.printf("%s %s\n", ok ? "ok    " : "FAILED", what);
+    if (!ok)
+        failures++;
+}
+
+ShellyPlus1PM slow(SERVER, "YourShellyPassword");
+ShellyPlus1PM fast1(SERVER, "YourShellyPassword");
+ShellyPlus1PM fast2(SERVER, "YourShellyPassword");
+ShellyPlus1PM fast3(SERVER, "YourShellyPassword");
+
+int main()
+{
+    shellyPoller poller(4);
+    poller.add(slow, "Switch.GetStatus?id=0");
+    poller.add(fast1, "Switch.GetStatus?id=0");
+    poller.add(slow, "Switch.GetConfig?id=0");
+    poller.add(fast2, "Switch.GetStatus?id=0");
+    poller.add(slow, "Sys.GetStatus");
+    poller.add(fast3, "Switch.GetStatus?id=0");
+    int results = 0, ok = 0, slowOrder = 0;
+    bool slowInOrder = true;
+    poller.onResult([&](const shellyPollJob &job) {
+        results++;
+        ok += (job.httpResponseCode == HTTP_CODE_OK) && (job.payload.length() > 0);
+        if (job.device == &slow) // jobs of a device are processed in the order added
+        {
+            static const char* order[] = { "Switch.GetStatus?id=0", "Switch.GetConfig?id=0", "Sys.GetStatus" };
+            slowInOrder &= (job.rpcMethod == order[slowOrder++ % 3]);
+        }
+    });
+    unsigned long longestHandle = 0;
+    for (int cycle=0; cycle<2; cycle++) // first cycle connects and authenticates
+    {
+        results = ok = 0;
+        check(poller.start(), "cycle started");
+        unsigned long start = millis();
+        while (poller.running() && (millis() - start < 20 * DELAY))
+        {
+            unsigned long t = millis();
+            poller.handle();
+            longestHandle = max(longestHandle, millis() - t);
+            delay(1);
+        }
+        Serial.printf("cycle %d: %lu ms, %d results, %d ok\n", cycle, poller.cycleTime(), results, ok);
+    }
+    Serial.printf("workers %u, longest handle() %lu ms\n", poller.workers(), longestHandle);
+    check(poller.workers() == 4, "worker threads created");
+    check((results == 6) && (ok == 6), "all requests answered");
+    check(slowInOrder, "requests to same device in order");
+    for (uint8_t i=0; i<poller.jobs(); i++)
+        if (poller.job(i).httpResponseCode != HTTP_CODE_OK)
+            check(false, "result kept after cycle");
+    check(poller.cycleTime() >= 3 * DELAY, "cycle not shorter than slowest device");
+    check(poller.cycleTime() < 4 * DELAY, "cycle shorter than slowest device + 1 request (sum is 6)");
+    check(longestHandle < DELAY / 4, "handle() does not block");
+    Serial.println(failures ? "FAILED" : "PASSED");
+    Serial.flush();
+    return failures ? 1 : 0;
+}
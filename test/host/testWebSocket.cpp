@@ -0,0 +1,55 @@
+#include <Arduino.h>
+#include "shellyWebSocket.h"
+
+// shellyWebSocket against examples/mockShelly.py (run by ctest, see CMakeLists.txt)
+// The mock pushes a NotifyStatus every 0.1 s with a new apower (48.3 in Shelly.GetStatus),
+// every 5th one is a NotifyEvent.
+
+#ifndef SERVER
+#define SERVER "127.0.0.1:18080"
+#endif
+
+int main()
+{
+    ShellyPlus1PM device(SERVER, "YourShellyPassword");
+    device.setStatusTTL(100000); // use pushed status only
+    shellyWebSocket ws(device);
+    unsigned long changes = 0, events = 0, pushed = 0;
+    String apower;
+    ws.onChange([&](const char* path, const char* value) {
+        changes++;
+        if (strcmp(path, "switch:0.apower") == 0)
+        {
+            pushed += (apower.length() > 0) && (strcmp(value, "48.3") != 0); // not initial status
+            apower = value;
+        }
+    });
+    ws.onEvent([&](const char* component, const char* /*event*/) {
+        events++;
+        Serial.printf("event of %s\n", component);
+    });
+    if (!ws.begin())
+    {
+        Serial.println("connecting failed");
+        return 1;
+    }
+    unsigned long start = millis();
+    while (millis() - start < 1500)
+    {
+        ws.handle();
+        delay(2);
+    }
+    Serial.printf("connected %d, notifications %lu, changes %lu, events %lu, apower pushed %lu, last %s, status %.1f\n",
+        ws.connected(), ws.notifications(), changes, events, pushed, apower.c_str(), device.ActivePower());
+    bool ok = ws.connected() && (ws.notifications() >= 5) && (events >= 1) && (pushed >= 1) &&
+        (fabs(device.ActivePower() - apower.toFloat()) < 0.01); // last pushed value applied to snapshot
+    // snapshots are read again after connection closed
+    unsigned long closed = millis();
+    ws.end();
+    device.ActivePower();
+    Serial.printf("status updated %ld ms after close\n", (long)(device.SwitchStatus().updated - closed));
+    ok &= ((long)(device.SwitchStatus().updated - closed) >= 0);
+    Serial.println(ok ? "PASSED" : "FAILED");
+    Serial.flush();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+# run command while examples/mockShelly.py is serving, used by ctest
+#
+#   python3 withMock.py --port 18080 --password secret [--notify 0.1] [--delay 100] [--nonce-ttl 1] -- command [args]
+#
+# Exit code is the one of command, output of the mock is shown after it.
+
+import argparse
+import os
+import socket
+import subprocess
+import sys
+import time
+
+MOCK = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "examples", "mockShelly.py")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="run command against mockShelly.py")
+    parser.add_argument("--port", type=int, default=18080)
+    parser.add_argument("--password", default="")
+    parser.add_argument("--notify", type=float, default=1)
+    parser.add_argument("--delay", type=float, default=0)
+    parser.add_argument("--nonce-ttl", type=float, default=60)
+    parser.add_argument("command", nargs=argparse.REMAINDER)
+    args = parser.parse_args()
+    command = args.command[1:] if args.command[:1] == ["--"] else args.command
+    mock = subprocess.Popen([sys.executable, MOCK, "--port", str(args.port), "--password", args.password,
+                             "--notify", str(args.notify), "--delay", str(args.delay),
+                             "--nonce-ttl", str(args.nonce_ttl)], stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    try:
+        deadline = time.time() + 10
+        while True:  # wait until mock accepts connections
+            try:
+                socket.create_connection(("127.0.0.1", args.port), timeout=1).close()
+                break
+            except OSError:
+                if mock.poll() is not None or time.time() > deadline:
+                    print(mock.stdout.read())
+                    return 1
+                time.sleep(0.05)
+        result = subprocess.call(command)
+    finally:
+        mock.terminate()
+        output, _ = mock.communicate()
+        print(output, end="")
+    return result
+
+
+if __name__ == "__main__":
+    sys.exit(main())